@@ -0,0 +1,645 @@
+#ifndef BTREE_H
+#define BTREE_H
+
+#include <cassert>  //assert
+#include <cstddef>  //ptrdiff_t
+#include <functional> //less
+#include <iostream> //ostream
+#include <iterator> //bidirectional_iterator_tag
+#include <utility>  //pair, move
+#include <algorithm> //copy, move, move_backward
+#include <sstream>  //ostringstream
+#include <string>
+#include <vector>
+
+// EFFECTS: Returns the default number of elements per BTree node for
+//          elements of the given size: enough to fill about four cache
+//          lines, and never fewer than eight.
+constexpr size_t btree_default_fanout(size_t element_size) {
+  return 256 / element_size < 8 ? 8 : 256 / element_size;
+}
+
+// A sorted set stored as a B+-tree. Every element lives in a leaf, each
+// node holds up to Fanout elements or keys in one array, and the leaves
+// are linked in order. A lookup visits one node per level, and there are
+// log base Fanout/2 of n levels instead of log base 2. Iterating follows
+// the leaf links and reads each leaf front to back.
+//
+// BTree offers the lookups, insertion, iteration, traversals and checks
+// of BinarySearchTree, but not its erasure, ranks, merging or freezing.
+// Elements must be default constructible, since every node holds a full
+// array of them.
+template <typename T,
+          typename Compare=std::less<T>, // default if argument isn't provided
+          size_t Fanout=btree_default_fanout(sizeof(T))
+         >
+class BTree {
+
+  static_assert(Fanout >= 3, "BTree nodes must hold at least 3 elements");
+
+private:
+
+  // A node holds up to Fanout items, and one more while it is being split
+  struct Node {
+    explicit Node(bool leaf_in)
+      : leaf(leaf_in), count(0) { }
+
+    bool leaf;
+
+    // Number of elements in a leaf, or of keys in an internal node
+    size_t count;
+    T items[Fanout + 1];
+  };
+
+  struct Leaf : Node {
+    Leaf()
+      : Node(true), prev(nullptr), next(nullptr) { }
+
+    // Neighbouring leaves in sorted order
+    Leaf *prev;
+    Leaf *next;
+  };
+
+  // Key i is the minimum element under children[i + 1]
+  struct Internal : Node {
+    Internal()
+      : Node(false) { }
+
+    Node *children[Fanout + 2];
+  };
+
+public:
+
+  // Default constructor
+  // (Note this will default construct the less comparator)
+  BTree()
+    : root(nullptr), first_leaf(nullptr), last_leaf(nullptr),
+      num_levels(0), num_elements(0) { }
+
+  // Copy constructor
+  BTree(const BTree &other)
+    : root(nullptr), first_leaf(nullptr), last_leaf(nullptr),
+      num_levels(other.num_levels), num_elements(other.num_elements),
+      less(other.less) {
+    root = copy_nodes_impl(other.root);
+  }
+
+  // Assignment operator
+  BTree &operator=(const BTree &rhs) {
+    if (this == &rhs) {
+      return *this;
+    }
+    BTree copy(rhs);
+    std::swap(root, copy.root);
+    std::swap(first_leaf, copy.first_leaf);
+    std::swap(last_leaf, copy.last_leaf);
+    std::swap(num_levels, copy.num_levels);
+    std::swap(num_elements, copy.num_elements);
+    std::swap(less, copy.less);
+    return *this;
+  }
+
+  // Destructor
+  ~BTree() {
+    destroy_nodes_impl(root);
+  }
+
+  // EFFECTS: Returns whether this BTree is empty.
+  bool empty() const {
+    return num_elements == 0;
+  }
+
+  // EFFECTS: Returns the number of levels of nodes, which is 0 for an
+  //          empty tree.
+  size_t height() const {
+    return num_levels;
+  }
+
+  // EFFECTS: Returns the number of elements in this BTree.
+  size_t size() const {
+    return num_elements;
+  }
+
+  // EFFECTS: Prints each element to os in ascending order. Each element
+  //          is followed by a space (there will be an "extra" space at
+  //          the end). If the tree is empty, nothing is printed.
+  void traverse_inorder(std::ostream &os) const {
+    for (const T &elt : *this) {
+      os << elt << " ";
+    }
+  }
+
+  // EFFECTS: Prints the items of each node, the keys of internal nodes
+  //          included, before those of its children, so the output shows
+  //          the structure of the tree. Each item is followed by a space.
+  //          If the tree is empty, nothing is printed.
+  void traverse_preorder(std::ostream &os) const {
+    traverse_preorder_impl(root, os);
+  }
+
+  // EFFECTS: Returns whether the elements are in strictly ascending
+  //          order. check_invariants() checks the structure as well.
+  bool check_sorting_invariant() const {
+    for (const Leaf *leaf = first_leaf; leaf; leaf = leaf->next) {
+      for (size_t i = 0; i < leaf->count; ++i) {
+        const T *prev = i > 0 ? &leaf->items[i - 1]
+          : leaf->prev ? &leaf->prev->items[leaf->prev->count - 1]
+          : nullptr;
+        if (prev && !less(*prev, leaf->items[i])) return false;
+      }
+    }
+    return true;
+  }
+
+  class Iterator {
+    // OVERVIEW: Iterator interface for BTree. Iterates over the elements
+    //           in ascending order. An Iterator is a leaf and a position
+    //           in it, and moves between leaves along their links.
+
+  public:
+    // Member types so standard algorithms accept an Iterator
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T *;
+    using reference = T &;
+
+    Iterator()
+      : leaf(nullptr), index(0) { }
+
+    // EFFECTS:  Returns the current element by reference.
+    // WARNING:  It is the responsibility of the user to ensure that any
+    //           modifications result in a new value that compares equal
+    //           to the existing value.
+    T &operator*() const {
+      return leaf->items[index];
+    }
+
+    // EFFECTS:  Returns the current element by pointer.
+    // WARNING:  See operator*.
+    T *operator->() const {
+      return &leaf->items[index];
+    }
+
+    // Prefix ++
+    Iterator &operator++() {
+      if (++index == leaf->count) {
+        leaf = leaf->next;
+        index = 0;
+      }
+      return *this;
+    }
+
+    // Postfix ++ (implemented in terms of prefix ++)
+    Iterator operator++(int) {
+      Iterator result(*this);
+      ++(*this);
+      return result;
+    }
+
+    // REQUIRES: this Iterator is not an end Iterator
+    // EFFECTS:  Moves to the previous element, or to an end Iterator if
+    //           this Iterator is at the minimum element.
+    // Prefix --
+    Iterator &operator--() {
+      if (index > 0) {
+        --index;
+      }
+      else {
+        leaf = leaf->prev;
+        index = leaf ? leaf->count - 1 : 0;
+      }
+      return *this;
+    }
+
+    // Postfix -- (implemented in terms of prefix --)
+    Iterator operator--(int) {
+      Iterator result(*this);
+      --(*this);
+      return result;
+    }
+
+    bool operator==(const Iterator &rhs) const {
+      return leaf == rhs.leaf && index == rhs.index;
+    }
+
+    bool operator!=(const Iterator &rhs) const {
+      return !(*this == rhs);
+    }
+
+  private:
+    friend class BTree;
+
+    Leaf *leaf;
+    size_t index;
+
+    Iterator(Leaf *leaf_in, size_t index_in)
+      : leaf(leaf_in), index(index_in) { }
+
+  }; // BTree::Iterator
+  ////////////////////////////////////////
+
+  // EFFECTS : Returns an iterator to the first element in this BTree.
+  Iterator begin() const {
+    return Iterator(first_leaf, 0);
+  }
+
+  // EFFECTS: Returns an iterator to past-the-end.
+  Iterator end() const {
+    return Iterator();
+  }
+
+  // EFFECTS: Returns an Iterator to the minimum element in this BTree or
+  //          an end Iterator if the tree is empty.
+  Iterator min_element() const {
+    return begin();
+  }
+
+  // EFFECTS: Returns an Iterator to the maximum element in this BTree or
+  //          an end Iterator if the tree is empty.
+  Iterator max_element() const {
+    if (empty()) return end();
+    return Iterator(last_leaf, last_leaf->count - 1);
+  }
+
+  // EFFECTS: Returns an Iterator to the minimum element in this BTree
+  //          greater than the given value.
+  //          If the tree is empty, returns an end Iterator.
+  Iterator min_greater_than(const T &value) const {
+    if (empty()) return end();
+    Leaf *leaf = find_leaf_impl(root, value, less);
+    size_t index = position_impl(leaf, value, true, less);
+    if (index == leaf->count) return Iterator(leaf->next, 0);
+    return Iterator(leaf, index);
+  }
+
+  // EFFECTS: Searches this tree for an element equivalent to query.
+  //          Returns an iterator to the existing element if found,
+  //          and an end iterator otherwise.
+  Iterator find(const T &query) const {
+    return find_impl(query);
+  }
+
+  // EFFECTS: Same as above for a query of another type, which is compared
+  //          with the elements directly. Only available if Compare is
+  //          transparent, that is, if it defines is_transparent.
+  template <typename Query, typename C = Compare,
+            typename = typename C::is_transparent>
+  Iterator find(const Query &query) const {
+    return find_impl(query);
+  }
+
+  // MODIFIES: this BTree
+  // EFFECTS : Inserts item unless an equivalent element is already
+  //           present. Returns an Iterator to the element equivalent to
+  //           item, and whether item was inserted.
+  std::pair<Iterator, bool> insert_unique(const T &item) {
+    return find_or_insert(item, item);
+  }
+
+  // MODIFIES: this BTree
+  // EFFECTS : Searches for an element equivalent to query, which may be
+  //           of any type that Compare can compare with T. If one is
+  //           found, returns an Iterator to it and false. Otherwise,
+  //           constructs an element from args, which must be equivalent
+  //           to query, inserts it where the search ended, and returns
+  //           an Iterator to it and true. Either way the tree is
+  //           descended only once, and nothing is constructed if query
+  //           is found.
+  template <typename Query, typename... Args>
+  std::pair<Iterator, bool> find_or_insert(const Query &query,
+                                           Args&&... args) {
+    if (root == nullptr) {
+      root = first_leaf = last_leaf = new Leaf;
+      num_levels = 1;
+    }
+    Insert_result result =
+      insert_impl(root, query, std::forward<Args>(args)...);
+    if (result.sibling) {
+      // The root was split, so the tree grows a level
+      Internal *new_root = new Internal;
+      new_root->items[0] = std::move(result.separator);
+      new_root->children[0] = root;
+      new_root->children[1] = result.sibling;
+      new_root->count = 1;
+      root = new_root;
+      ++num_levels;
+    }
+    if (result.inserted) ++num_elements;
+    return std::make_pair(Iterator(result.leaf, result.index),
+                          result.inserted);
+  }
+
+  // REQUIRES: The given item is not already contained in this BTree
+  // MODIFIES: this BTree
+  // EFFECTS : Inserts the element item into this BTree, maintaining
+  //           the sorting invariant.
+  Iterator insert(const T &item) {
+    std::pair<Iterator, bool> result = insert_unique(item);
+    assert(result.second);
+    return result.first;
+  }
+
+  // EFFECTS: Returns a human-readable string representation of this
+  //          BTree, with one line per level and each node's items in
+  //          brackets. Works best for small trees.
+  std::string to_string() const {
+    std::ostringstream os;
+    std::vector<const Node *> level;
+    if (root) level.push_back(root);
+    while (!level.empty()) {
+      std::vector<const Node *> below;
+      for (size_t i = 0; i < level.size(); ++i) {
+        const Node *node = level[i];
+        os << (i > 0 ? " [ " : "[ ");
+        for (size_t j = 0; j < node->count; ++j) {
+          os << node->items[j] << " ";
+        }
+        os << "]";
+        if (!node->leaf) {
+          const Internal *internal = static_cast<const Internal *>(node);
+          below.insert(below.end(), internal->children,
+                       internal->children + internal->count + 1);
+        }
+      }
+      os << "\n";
+      level.swap(below);
+    }
+    return os.str();
+  }
+
+  // EFFECTS: Returns whether every node is sorted, within the bounds set
+  //          by its keys, and between half full and full, and whether
+  //          all leaves are at the same depth and linked in order.
+  bool check_invariants() const {
+    if (root == nullptr) return num_elements == 0 && num_levels == 0;
+    const Leaf *last = nullptr;
+    size_t count = 0;
+    return check_invariants_impl(root, nullptr, nullptr, 1, last, count,
+                                 less)
+      && last == last_leaf && last->next == nullptr
+      && count == num_elements;
+  }
+
+private:
+
+  // DATA REPRESENTATION
+  Node *root;
+
+  // The ends of the list of leaves
+  Leaf *first_leaf;
+  Leaf *last_leaf;
+
+  size_t num_levels;
+  size_t num_elements;
+
+  // An instance of the Compare type. Use this to compare elements.
+  Compare less;
+
+  // Where an insertion below a node ended up, and the new right sibling
+  // of that node if it had to be split, along with the key that separates
+  // the node from its sibling.
+  struct Insert_result {
+    Leaf *leaf;
+    size_t index;
+    bool inserted;
+    Node *sibling;
+    T separator;
+  };
+
+  // EFFECTS: Returns the number of items of 'node' that are less than
+  //          'value', or not greater than 'value' if 'upper'.
+  template <typename Query>
+  static size_t position_impl(const Node *node, const Query &value,
+                              bool upper, Compare less) {
+    size_t low = 0;
+    size_t high = node->count;
+    while (low < high) {
+      size_t middle = (low + high) / 2;
+      bool before = upper ? !less(value, node->items[middle])
+                          : less(node->items[middle], value);
+      if (before) low = middle + 1;
+      else high = middle;
+    }
+    return low;
+  }
+
+  // REQUIRES: the tree rooted at 'node' is not empty
+  // EFFECTS : Returns the leaf where 'value' is or would be.
+  template <typename Query>
+  static Leaf * find_leaf_impl(Node *node, const Query &value,
+                               Compare less) {
+    while (!node->leaf) {
+      size_t child = position_impl(node, value, true, less);
+      node = static_cast<Internal *>(node)->children[child];
+    }
+    return static_cast<Leaf *>(node);
+  }
+
+  // EFFECTS: Implements find for any type of query.
+  template <typename Query>
+  Iterator find_impl(const Query &query) const {
+    if (empty()) return end();
+    Leaf *leaf = find_leaf_impl(root, query, less);
+    size_t index = position_impl(leaf, query, false, less);
+    if (index == leaf->count || less(query, leaf->items[index])) {
+      return end();
+    }
+    return Iterator(leaf, index);
+  }
+
+  // MODIFIES: the tree rooted at 'node'
+  // EFFECTS : Inserts an element constructed from 'args' below 'node'
+  //           unless one equivalent to 'query' is already there,
+  //           splitting nodes that overflow on the way back up.
+  template <typename Query, typename... Args>
+  Insert_result insert_impl(Node *node, const Query &query,
+                            Args&&... args) {
+    if (node->leaf) {
+      return insert_leaf_impl(static_cast<Leaf *>(node), query,
+                              std::forward<Args>(args)...);
+    }
+    Internal *internal = static_cast<Internal *>(node);
+    size_t child = position_impl(internal, query, true, less);
+    Insert_result result = insert_impl(internal->children[child], query,
+                                       std::forward<Args>(args)...);
+    if (result.sibling == nullptr) return result;
+
+    // Add the new child and its separator after the one that split
+    size_t count = internal->count;
+    std::move_backward(internal->items + child, internal->items + count,
+                       internal->items + count + 1);
+    internal->items[child] = std::move(result.separator);
+    std::move_backward(internal->children + child + 1,
+                       internal->children + count + 1,
+                       internal->children + count + 2);
+    internal->children[child + 1] = result.sibling;
+    ++internal->count;
+    result.sibling = nullptr;
+    if (internal->count <= Fanout) return result;
+
+    // Split: the middle key moves up and the keys after it move right
+    Internal *sibling = new Internal;
+    size_t middle = internal->count / 2;
+    std::move(internal->items + middle + 1,
+              internal->items + internal->count, sibling->items);
+    std::move(internal->children + middle + 1,
+              internal->children + internal->count + 1, sibling->children);
+    sibling->count = internal->count - middle - 1;
+    internal->count = middle;
+    result.sibling = sibling;
+    result.separator = std::move(internal->items[middle]);
+    return result;
+  }
+
+  // MODIFIES: leaf
+  // EFFECTS : Inserts an element constructed from 'args' into 'leaf'
+  //           unless one equivalent to 'query' is already there,
+  //           splitting it if it overflows.
+  template <typename Query, typename... Args>
+  Insert_result insert_leaf_impl(Leaf *leaf, const Query &query,
+                                 Args&&... args) {
+    size_t index = position_impl(leaf, query, false, less);
+    Insert_result result = { leaf, index, false, nullptr, T() };
+    if (index < leaf->count && !less(query, leaf->items[index])) {
+      return result;
+    }
+    result.inserted = true;
+    std::move_backward(leaf->items + index, leaf->items + leaf->count,
+                       leaf->items + leaf->count + 1);
+    leaf->items[index] = T(std::forward<Args>(args)...);
+    ++leaf->count;
+    if (leaf->count <= Fanout) return result;
+
+    // Split: the upper half moves to a new leaf, and a copy of its first
+    // element separates it from this one
+    Leaf *sibling = new Leaf;
+    size_t middle = leaf->count / 2;
+    std::move(leaf->items + middle, leaf->items + leaf->count,
+              sibling->items);
+    sibling->count = leaf->count - middle;
+    leaf->count = middle;
+
+    sibling->prev = leaf;
+    sibling->next = leaf->next;
+    if (leaf->next) leaf->next->prev = sibling;
+    else last_leaf = sibling;
+    leaf->next = sibling;
+    result.separator = sibling->items[0];
+
+    if (index >= middle) {
+      result.leaf = sibling;
+      result.index = index - middle;
+    }
+    result.sibling = sibling;
+    return result;
+  }
+
+  // EFFECTS: Returns a copy of the tree rooted at 'node', appending its
+  //          leaves to the list of leaves of this tree.
+  // NOTE:    This function must be tree recursive.
+  Node * copy_nodes_impl(const Node *node) {
+    if (node == nullptr) return nullptr;
+    if (node->leaf) {
+      Leaf *leaf = new Leaf;
+      std::copy(node->items, node->items + node->count, leaf->items);
+      leaf->count = node->count;
+      leaf->prev = last_leaf;
+      if (last_leaf) last_leaf->next = leaf;
+      else first_leaf = leaf;
+      last_leaf = leaf;
+      return leaf;
+    }
+    const Internal *internal = static_cast<const Internal *>(node);
+    Internal *copy = new Internal;
+    std::copy(internal->items, internal->items + internal->count,
+              copy->items);
+    copy->count = internal->count;
+    for (size_t i = 0; i <= internal->count; ++i) {
+      copy->children[i] = copy_nodes_impl(internal->children[i]);
+    }
+    return copy;
+  }
+
+  // EFFECTS: Prints the items of the tree rooted at 'node' in pre-order,
+  //          each followed by a space.
+  // NOTE:    This function must be tree recursive.
+  static void traverse_preorder_impl(const Node *node, std::ostream &os) {
+    if (node == nullptr) return;
+    for (size_t i = 0; i < node->count; ++i) {
+      os << node->items[i] << " ";
+    }
+    if (node->leaf) return;
+    const Internal *internal = static_cast<const Internal *>(node);
+    for (size_t i = 0; i <= internal->count; ++i) {
+      traverse_preorder_impl(internal->children[i], os);
+    }
+  }
+
+  // EFFECTS: Frees the memory for all nodes in the tree rooted at 'node'.
+  // NOTE:    This function must be tree recursive.
+  static void destroy_nodes_impl(Node *node) {
+    if (node == nullptr) return;
+    if (node->leaf) {
+      delete static_cast<Leaf *>(node);
+      return;
+    }
+    Internal *internal = static_cast<Internal *>(node);
+    for (size_t i = 0; i <= internal->count; ++i) {
+      destroy_nodes_impl(internal->children[i]);
+    }
+    delete internal;
+  }
+
+  // MODIFIES: last, count
+  // EFFECTS:  Checks the tree rooted at 'node', which is at 'depth' and
+  //           whose elements must be at least *lower and less than *upper
+  //           (a null bound is unbounded). Each leaf must follow 'last' in
+  //           the list of leaves; 'last' and 'count' are advanced past
+  //           its leaves.
+  bool check_invariants_impl(const Node *node, const T *lower,
+                             const T *upper, size_t depth,
+                             const Leaf *&last, size_t &count,
+                             Compare less) const {
+    if (node->count > Fanout) return false;
+    if (node != root && node->count < Fanout / 2) return false;
+    for (size_t i = 0; i < node->count; ++i) {
+      if (i > 0 && !less(node->items[i - 1], node->items[i])) return false;
+      if (lower && less(node->items[i], *lower)) return false;
+      if (upper && !less(node->items[i], *upper)) return false;
+    }
+    if (node->leaf) {
+      const Leaf *leaf = static_cast<const Leaf *>(node);
+      if (depth != num_levels || leaf->prev != last) return false;
+      if (last ? last->next != leaf : leaf != first_leaf) return false;
+      last = leaf;
+      count += leaf->count;
+      return node == root || node->count > 0;
+    }
+    const Internal *internal = static_cast<const Internal *>(node);
+    for (size_t i = 0; i <= internal->count; ++i) {
+      const T *low = i == 0 ? lower : &internal->items[i - 1];
+      const T *high = i == internal->count ? upper : &internal->items[i];
+      if (!check_invariants_impl(internal->children[i], low, high,
+                                 depth + 1, last, count, less)) {
+        return false;
+      }
+    }
+    return true;
+  }
+}; // END of BTree class
+
+// MODIFIES: os
+// EFFECTS : Prints the elements in the tree to the given ostream in
+//           the same format as a BinarySearchTree.
+template <typename T, typename Compare, size_t Fanout>
+std::ostream &operator<<(std::ostream &os,
+                         const BTree<T, Compare, Fanout> &tree) {
+  os << "[ ";
+  for (T& elt : tree) {
+    os << elt << " ";
+  }
+  return os << "]";
+}
+
+#endif // BTREE_H
@@ -0,0 +1,97 @@
+#ifndef BTREE_MAP_H
+#define BTREE_MAP_H
+
+#include "BTree.h"
+#include <cassert>  //assert
+#include <utility>  //pair, piecewise_construct
+#include <tuple>    //forward_as_tuple
+
+// OVERVIEW: A Map stored in a BTree instead of a BinarySearchTree. It
+//           offers find, operator[], insert and iteration the way Map
+//           does. Key_type and Value_type must be default constructible,
+//           since BTree nodes hold full arrays of pairs.
+template <typename Key_type, typename Value_type,
+          typename Key_compare=std::less<Key_type> // default argument
+         >
+class BTreeMap {
+
+private:
+  using Pair_type = std::pair<Key_type, Value_type>;
+
+  // A custom comparator
+  class PairComp {
+    private:
+      Key_compare less;
+
+    public:
+      using is_transparent = void;
+
+      bool operator()(const Pair_type &lhs, const Pair_type &rhs) const {
+        return less(lhs.first, rhs.first);
+      }
+
+      template <typename K>
+      bool operator()(const K &lhs, const Pair_type &rhs) const {
+        return less(lhs, rhs.first);
+      }
+      template <typename K>
+      bool operator()(const Pair_type &lhs, const K &rhs) const {
+        return less(lhs.first, rhs);
+      }
+  };
+
+  using Tree_type = BTree<Pair_type, PairComp>;
+  Tree_type tree;
+
+public:
+
+  using Iterator = typename Tree_type::Iterator;
+
+  // EFFECTS : Returns whether this BTreeMap is empty.
+  bool empty() const {
+    return tree.empty();
+  }
+
+  // EFFECTS : Returns the number of elements in this BTreeMap.
+  size_t size() const {
+    return tree.size();
+  }
+
+  // EFFECTS : Searches this BTreeMap for an element with a key equivalent
+  //           to k and returns an Iterator to the associated value if found,
+  //           otherwise returns an end Iterator.
+  Iterator find(const Key_type& k) const {
+    return tree.find(k);
+  }
+
+  // MODIFIES: this
+  // EFFECTS : Returns a reference to the mapped value for the given key,
+  //           inserting the key with a value-initialized mapped value if
+  //           it is not present.
+  Value_type& operator[](const Key_type& k) {
+    return tree.find_or_insert(k, std::piecewise_construct,
+                               std::forward_as_tuple(k),
+                               std::forward_as_tuple()).first->second;
+  }
+
+  // MODIFIES: this
+  // EFFECTS : Inserts the given element unless its key is already present.
+  //           Returns an iterator to the element with that key, along with
+  //           whether the given element was inserted.
+  std::pair<Iterator, bool> insert(const Pair_type &val) {
+    return tree.find_or_insert(val.first, val);
+  }
+
+  // EFFECTS : Returns an iterator to the first key-value pair in this
+  //           BTreeMap.
+  Iterator begin() const {
+    return tree.begin();
+  }
+
+  // EFFECTS : Returns an iterator to "past-the-end".
+  Iterator end() const {
+    return tree.end();
+  }
+};
+
+#endif // BTREE_MAP_H
@@ -0,0 +1,115 @@
+// Compares BTreeMap with Map and std::map on the operations the
+// classifier does: counting words while training, looking words up while
+// predicting, and scanning every entry.
+//
+// Usage: BTree_benchmark.exe [TRAIN_FILE TEST_FILE]
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "csvstream.h"
+#include "Map.h"
+#include "BTreeMap.h"
+
+using namespace std;
+
+// EFFECTS: Returns every word in the content column of the given file,
+//          in order, including repeats.
+static vector<string> read_words(const string &filename) {
+  csvstream csvin(filename, {"content"});
+  vector<string> words;
+  vector<string> row;
+  while (csvin >> row) {
+    istringstream source(row[0]);
+    string word;
+    while (source >> word) {
+      words.push_back(word);
+    }
+  }
+  return words;
+}
+
+// EFFECTS: Returns the seconds spent running fn 'repeat' times.
+template <typename Function>
+static double time_it(int repeat, Function fn) {
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i) {
+    fn();
+  }
+  chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// EFFECTS: Times counting the training words, finding the test words and
+//          scanning the counts with a Map_type, and prints one line.
+template <typename Map_type>
+static void benchmark(const string &name, const vector<string> &train,
+                      const vector<string> &test, int repeat) {
+  size_t checksum = 0;
+  double build = time_it(repeat, [&]() {
+    Map_type counts;
+    for (const string &word : train) {
+      ++counts[word];
+    }
+    checksum += counts.size();
+  });
+
+  Map_type counts;
+  for (const string &word : train) {
+    ++counts[word];
+  }
+  double lookup = time_it(repeat, [&]() {
+    for (const string &word : test) {
+      typename Map_type::const_iterator it = counts.find(word);
+      if (it != counts.end()) checksum += it->second;
+    }
+  });
+  double scan = time_it(repeat * 10, [&]() {
+    for (const auto &entry : counts) {
+      checksum += entry.second;
+    }
+  });
+
+  cout << left << setw(10) << name << right << fixed << setprecision(4)
+       << setw(10) << build << setw(10) << lookup << setw(10) << scan
+       << "   (checksum " << checksum << ")\n";
+}
+
+// Gives Map and BTreeMap the member type std::map has, so one benchmark
+// template handles all three
+template <typename Base>
+struct with_const_iterator : Base {
+  using const_iterator = typename Base::Iterator;
+};
+
+int main(int argc, char **argv) {
+  string train_file = "w14-f15_instructor_student.csv";
+  string test_file = "w16_instructor_student.csv";
+  if (argc == 3) {
+    train_file = argv[1];
+    test_file = argv[2];
+  }
+  else if (argc != 1) {
+    cout << "Usage: BTree_benchmark.exe [TRAIN_FILE TEST_FILE]" << endl;
+    return 1;
+  }
+
+  vector<string> train = read_words(train_file);
+  vector<string> test = read_words(test_file);
+  const int repeat = 5;
+  cout << train.size() << " training words, " << test.size()
+       << " test words, " << repeat << " repetitions\n";
+  cout << left << setw(10) << "container" << right << setw(10) << "build"
+       << setw(10) << "lookup" << setw(10) << "scan" << "\n";
+
+  benchmark<with_const_iterator<Map<string, int>>>("Map", train, test,
+                                                    repeat);
+  benchmark<with_const_iterator<BTreeMap<string, int>>>("BTreeMap", train,
+                                                         test, repeat);
+  benchmark<map<string, int>>("std::map", train, test, repeat);
+}
@@ -0,0 +1,173 @@
+//
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include "BTree.h"
+#include "BTreeMap.h"
+#include "unit_test_framework.h"
+
+using namespace std;
+
+TEST(test_empty) {
+    BTree<int> tree;
+    ASSERT_TRUE(tree.empty());
+    ASSERT_EQUAL(tree.size(), 0);
+    ASSERT_EQUAL(tree.height(), 0);
+    ASSERT_TRUE(tree.begin() == tree.end());
+    ASSERT_TRUE(tree.find(3) == tree.end());
+    ASSERT_TRUE(tree.max_element() == tree.end());
+    ASSERT_TRUE(tree.min_greater_than(3) == tree.end());
+    ASSERT_TRUE(tree.check_invariants());
+}
+
+TEST(test_insert_sorted) {
+    BTree<int, less<int>, 4> tree;
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQUAL(*tree.insert(i), i);
+    }
+    ASSERT_EQUAL(tree.size(), 1000);
+    ASSERT_TRUE(tree.check_invariants());
+    // Every node is at least half full
+    ASSERT_TRUE(tree.height() <= 10);
+
+    int expected = 0;
+    for (int i : tree) {
+        ASSERT_EQUAL(i, expected++);
+    }
+    ASSERT_EQUAL(*tree.min_element(), 0);
+    ASSERT_EQUAL(*tree.max_element(), 999);
+}
+
+TEST(test_insert_random) {
+    BTree<int, less<int>, 3> tree;
+    vector<int> inserted;
+    srand(280);
+    for (int i = 0; i < 2000; ++i) {
+        int value = rand() % 5000;
+        pair<BTree<int, less<int>, 3>::Iterator, bool> result
+          = tree.insert_unique(value);
+        ASSERT_EQUAL(*result.first, value);
+        bool is_new = find(inserted.begin(), inserted.end(), value)
+          == inserted.end();
+        ASSERT_EQUAL(result.second, is_new);
+        if (is_new) inserted.push_back(value);
+    }
+    ASSERT_TRUE(tree.check_invariants());
+    sort(inserted.begin(), inserted.end());
+    ASSERT_EQUAL(tree.size(), inserted.size());
+    ASSERT_TRUE(equal(tree.begin(), tree.end(), inserted.begin()));
+
+    for (int i = -1; i < 5001; ++i) {
+        vector<int>::iterator it = upper_bound(inserted.begin(),
+                                               inserted.end(), i);
+        if (it == inserted.end()) {
+            ASSERT_TRUE(tree.min_greater_than(i) == tree.end());
+        }
+        else {
+            ASSERT_EQUAL(*tree.min_greater_than(i), *it);
+        }
+        bool present = binary_search(inserted.begin(), inserted.end(), i);
+        ASSERT_EQUAL(tree.find(i) != tree.end(), present);
+    }
+}
+
+TEST(test_insert_strings) {
+    // Splits move strings out of the items they leave behind, so every
+    // separator has to be carried up explicitly
+    BTree<string, less<string>, 3> tree;
+    vector<string> inserted;
+    srand(281);
+    for (int i = 0; i < 1000; ++i) {
+        string word = "word" + to_string(rand() % 3000);
+        if (tree.insert_unique(word).second) inserted.push_back(word);
+    }
+    ASSERT_TRUE(tree.check_invariants());
+    sort(inserted.begin(), inserted.end());
+    ASSERT_TRUE(equal(tree.begin(), tree.end(), inserted.begin()));
+    for (const string &word : inserted) {
+        ASSERT_EQUAL(*tree.find(word), word);
+    }
+}
+
+TEST(test_iterator_decrement) {
+    BTree<int, less<int>, 3> tree;
+    for (int i = 20; i > 0; --i) {
+        tree.insert(i);
+    }
+    vector<int> backwards;
+    for (BTree<int, less<int>, 3>::Iterator it = tree.max_element();
+         it != tree.end(); --it) {
+        backwards.push_back(*it);
+    }
+    ASSERT_EQUAL(backwards.size(), 20);
+    ASSERT_TRUE(is_sorted(backwards.rbegin(), backwards.rend()));
+}
+
+TEST(test_copy) {
+    BTree<string, less<string>, 3> tree;
+    for (const char *word : {"exam", "euchre", "calculator", "image",
+                             "bob", "dealer", "segfault", "piazza"}) {
+        tree.insert(word);
+    }
+    BTree<string, less<string>, 3> copy(tree);
+    tree.insert("zebra");
+    ASSERT_TRUE(copy.check_invariants());
+    ASSERT_EQUAL(copy.size(), 8);
+    ASSERT_TRUE(copy.find("zebra") == copy.end());
+
+    copy = tree;
+    ASSERT_TRUE(copy.check_invariants());
+    ASSERT_EQUAL(*copy.max_element(), "zebra");
+
+    ostringstream oss;
+    oss << copy;
+    ASSERT_EQUAL(oss.str(), "[ bob calculator dealer euchre exam image "
+                            "piazza segfault zebra ]");
+}
+
+TEST(test_traversals) {
+    BTree<int, less<int>, 3> tree;
+    ASSERT_EQUAL(tree.to_string(), "");
+    for (int i = 1; i <= 7; ++i) {
+        tree.insert(i);
+    }
+    ASSERT_TRUE(tree.check_sorting_invariant());
+
+    ostringstream inorder;
+    tree.traverse_inorder(inorder);
+    ASSERT_EQUAL(inorder.str(), "1 2 3 4 5 6 7 ");
+
+    ostringstream preorder;
+    tree.traverse_preorder(preorder);
+    // Leaves split into halves, and the root's keys are copies of the
+    // first elements of the leaves after the first
+    ASSERT_EQUAL(preorder.str(), "3 5 1 2 3 4 5 6 7 ");
+    ASSERT_EQUAL(tree.to_string(), "[ 3 5 ]\n"
+                                   "[ 1 2 ] [ 3 4 ] [ 5 6 7 ]\n");
+}
+
+TEST(test_map) {
+    BTreeMap<string, int> counts;
+    ASSERT_TRUE(counts.empty());
+    counts["exam"] += 1;
+    counts["euchre"] += 2;
+    counts["exam"] += 3;
+    ASSERT_EQUAL(counts.size(), 2);
+    ASSERT_EQUAL(counts["exam"], 4);
+    ASSERT_EQUAL(counts.begin()->first, "euchre");
+    ASSERT_TRUE(counts.find("image") == counts.end());
+
+    pair<BTreeMap<string, int>::Iterator, bool> result
+      = counts.insert({"exam", 10});
+    ASSERT_FALSE(result.second);
+    ASSERT_EQUAL(result.first->second, 4);
+    result = counts.insert({"image", 10});
+    ASSERT_TRUE(result.second);
+    ASSERT_EQUAL(counts.find("image")->second, 10);
+}
+
+TEST_MAIN()
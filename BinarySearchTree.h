@@ -4,9 +4,171 @@
 #include <cassert>  //assert
 #include <iostream> //ostream
 #include <functional> //less
+#include <algorithm> //max
+#include <iterator>  //distance, iterator_traits, make_move_iterator
+#include <cstddef>   //ptrdiff_t
+#include <new>        //operator new, placement new
+#include <vector>
+#include <type_traits> //is_trivially_destructible, is_nothrow_move_*
+#include <utility>   //forward, move, pair, swap
+#include "FrozenTree.h"
+#include "TreeLinks.h"
+
+// Balancing policies for BinarySearchTree.
+//   bst_unbalanced: Plain leaf insertion. The shape of the tree depends on
+//                   the insertion order, and sorted input gives a height of n.
+//   bst_avl:        AVL rebalancing. The heights of the two subtrees of every
+//                   node differ by at most one, so the height is O(log n).
+//   bst_splay:      Splaying. Every insertion rotates the new element up to
+//                   the root. So does every lookup through access(), or
+//                   attempt to insert an element already present, that
+//                   reaches deeper than twice the height of a balanced
+//                   tree, so frequently used elements stay near the top.
+//                   Insertions and access() take O(log n) amortized time.
+//                   find(), rank(), lower_bound() and the other const
+//                   functions, and erase(), leave the shape as is and take
+//                   time proportional to the depth they reach, which can
+//                   be up to n. Best when a few elements get most of the
+//                   lookups.
+struct bst_unbalanced {};
+struct bst_avl {};
+struct bst_splay {};
+
+// A comparator that compares values of any two types with <, like
+// std::less<void> in C++14. It is transparent: a BinarySearchTree or Map
+// using it can be searched with any type that compares with its elements
+// or keys, such as a const char * for std::string keys, without building
+// a temporary element.
+struct transparent_less {
+  using is_transparent = void;
+
+  template <typename A, typename B>
+  bool operator()(const A &lhs, const B &rhs) const {
+    return lhs < rhs;
+  }
+};
+
+// Storage for the nodes of one tree, handing out memory for one Node at a
+// time from slabs that hold many. Freed nodes are kept on a free list and
+// reused before a slab is touched again. release() gives back every slab
+// at once without looking at the nodes, so the caller destroys the nodes'
+// contents first if that is needed.
+template <typename Node>
+class bst_node_pool {
+public:
+  // Whether release() frees every node handed out so far
+  static constexpr bool releases_all = true;
+
+  bst_node_pool()
+    : free_list(nullptr), next(nullptr), remaining(0) { }
+
+  ~bst_node_pool() {
+    release();
+  }
+
+  // EFFECTS: Returns uninitialized memory for one Node.
+  void * allocate() {
+    if (free_list) {
+      void *slot = free_list;
+      free_list = *static_cast<void **>(slot);
+      return slot;
+    }
+    if (remaining == 0) {
+      // Slabs double in size up to a limit, so small trees stay small
+      size_t count = first_slab;
+      if (!slabs.empty()) {
+        count = 2 * slab_count.back();
+        if (count > max_slab) count = max_slab;
+      }
+      next = static_cast<Node *>(::operator new(count * sizeof(Node)));
+      slabs.push_back(next);
+      slab_count.push_back(count);
+      remaining = count;
+    }
+    --remaining;
+    return next++;
+  }
+
+  // REQUIRES: slot came from allocate() on this pool and holds no object
+  // EFFECTS:  Puts slot on the free list.
+  void deallocate(void *slot) {
+    *static_cast<void **>(slot) = free_list;
+    free_list = slot;
+  }
+
+  // EFFECTS: Exchanges the slabs and free lists of the two pools.
+  void swap(bst_node_pool &other) noexcept {
+    slabs.swap(other.slabs);
+    slab_count.swap(other.slab_count);
+    std::swap(free_list, other.free_list);
+    std::swap(next, other.next);
+    std::swap(remaining, other.remaining);
+  }
+
+  // EFFECTS: Frees every slab, which invalidates all memory handed out.
+  void release() {
+    for (size_t i = 0; i < slabs.size(); ++i) {
+      ::operator delete(slabs[i]);
+    }
+    slabs.clear();
+    slab_count.clear();
+    free_list = nullptr;
+    next = nullptr;
+    remaining = 0;
+  }
+
+private:
+  static const size_t first_slab = 16;
+  static const size_t max_slab = 4096;
+
+  std::vector<void *> slabs;
+  std::vector<size_t> slab_count;
+  void *free_list;
+  Node *next;
+  size_t remaining;
+
+  // A pool belongs to one tree
+  bst_node_pool(const bst_node_pool &);
+  bst_node_pool & operator=(const bst_node_pool &);
+};
+
+// Storage that allocates every node with operator new on its own.
+template <typename Node>
+class bst_node_heap {
+public:
+  static constexpr bool releases_all = false;
+
+  void * allocate() {
+    return ::operator new(sizeof(Node));
+  }
+
+  void deallocate(void *slot) {
+    ::operator delete(slot);
+  }
+
+  void swap(bst_node_heap &) noexcept { }
+
+  void release() { }
+};
+
+// Node allocation policies for BinarySearchTree.
+//   bst_heap_nodes: Each node is allocated and freed separately.
+//   bst_pool_nodes: Nodes are carved out of slabs owned by the tree, so
+//                   neighbouring insertions sit next to each other in
+//                   memory. Removed nodes are reused, and clearing or
+//                   destroying the tree frees whole slabs; with trivially
+//                   destructible elements it does not visit the nodes.
+struct bst_heap_nodes {
+  template <typename Node> using storage = bst_node_heap<Node>;
+};
+struct bst_pool_nodes {
+  template <typename Node> using storage = bst_node_pool<Node>;
+};
 
 template <typename T,
-          typename Compare=std::less<T> // default if argument isn't provided
+          typename Compare=std::less<T>, // default if argument isn't provided
+          typename Balance=bst_unbalanced,
+          typename Nodes=bst_heap_nodes
          >
 class BinarySearchTree {
 
@@ -14,16 +176,24 @@ private:
 
   struct Node {
 
-    // Default constructor - does nothing
-    Node() {}
-
-    // Custom constructor provided for convenience
-    Node(const T &datum_in, Node *left_in, Node *right_in)
-            : datum(datum_in), left(left_in), right(right_in) { }
+    // Constructs the datum in place from the given arguments, as a
+    // single-element tree
+    template <typename... Args>
+    explicit Node(Args&&... args)
+            : datum(std::forward<Args>(args)...), left(nullptr),
+              right(nullptr), parent(nullptr), height(1), subtree_size(1) { }
 
     T datum;
     Node *left;
     Node *right;
+
+    // The node this one is a child of, or null for the root
+    Node *parent;
+
+    // Height and number of elements of the subtree rooted at this node,
+    // kept up to date by every insertion and rotation
+    int height;
+    size_t subtree_size;
   };
 
 public:
@@ -33,23 +203,94 @@ public:
   BinarySearchTree()
     : root(nullptr) { }
 
+  // EFFECTS: Builds an empty tree that orders its elements with a copy
+  //          of 'less_in'.
+  explicit BinarySearchTree(const Compare &less_in)
+    : root(nullptr), less(less_in) { }
+
+  // REQUIRES: [first, last) is sorted and holds no equivalent elements
+  // EFFECTS:  Builds a perfectly balanced tree holding the elements of
+  //           [first, last) in O(n) time. The result satisfies every
+  //           Balance policy.
+  template <typename Iter>
+  BinarySearchTree(Iter first, Iter last)
+    : root(nullptr) {
+    assign(first, last);
+  }
+
   // Copy constructor
   BinarySearchTree(const BinarySearchTree &other)
-    : root(copy_nodes_impl(other.root)) { }
+    : root(nullptr), less(other.less) {
+    root = copy_nodes_impl(other.root, nullptr);
+  }
+
+  // Move constructor. Takes over the nodes of other, leaving it empty.
+  // It does not throw unless moving the comparator does, so containers
+  // of trees move them rather than copy them when they grow.
+  BinarySearchTree(BinarySearchTree &&other)
+    noexcept(std::is_nothrow_move_constructible<Compare>::value)
+    : root(other.root), less(std::move(other.less)) {
+    other.root = nullptr;
+    nodes.swap(other.nodes);
+  }
 
   // Assignment operator
   BinarySearchTree &operator=(const BinarySearchTree &rhs) {
     if (this == &rhs) {
       return *this;
     }
-    destroy_nodes_impl(root);
-    root = copy_nodes_impl(rhs.root);
+    clear();
+    less = rhs.less;
+    root = copy_nodes_impl(rhs.root, nullptr);
+    return *this;
+  }
+
+  // Move assignment operator. Takes over the nodes of rhs, leaving it
+  // empty.
+  BinarySearchTree &operator=(BinarySearchTree &&rhs)
+    noexcept(std::is_nothrow_move_assignable<Compare>::value) {
+    if (this == &rhs) {
+      return *this;
+    }
+    clear();
+    less = std::move(rhs.less);
+    root = rhs.root;
+    rhs.root = nullptr;
+    nodes.swap(rhs.nodes);
     return *this;
   }
 
   // Destructor
   ~BinarySearchTree() {
-    destroy_nodes_impl(root);
+    clear();
+  }
+
+  // MODIFIES: this BinarySearchTree
+  // EFFECTS:  Removes every element.
+  void clear() {
+    if (Storage::releases_all) {
+      if (!std::is_trivially_destructible<T>::value) {
+        destroy_data_impl(root);
+      }
+      nodes.release();
+    }
+    else {
+      destroy_nodes_impl(root);
+    }
+    root = nullptr;
+  }
+
+  // REQUIRES: [first, last) is sorted and holds no equivalent elements
+  // MODIFIES: this BinarySearchTree
+  // EFFECTS:  Replaces the contents with the elements of [first, last),
+  //           building a perfectly balanced tree in O(n) time. An input
+  //           range, which can only be read once, is first copied into a
+  //           buffer to count it.
+  template <typename Iter>
+  void assign(Iter first, Iter last) {
+    assign_impl(first, last,
+                typename std::iterator_traits<Iter>::iterator_category());
+    assert(check_sorting_invariant());
   }
 
   // EFFECTS: Returns whether this BinarySearchTree is empty.
@@ -59,12 +300,12 @@ public:
 
   // EFFECTS: Returns the height of the tree.
   size_t height() const {
-    return static_cast<size_t>(height_impl(root));
+    return static_cast<size_t>(node_height(root));
   }
 
   // EFFECTS: Returns the number of elements in this BinarySearchTree.
   size_t size() const {
-    return static_cast<size_t>(size_impl(root));
+    return node_size(root);
   }
 
   // EFFECTS: Traverses the tree using an in-order traversal,
@@ -88,19 +329,38 @@ public:
   //
   // NOTE: This function must be recursive.
   bool check_sorting_invariant() const {
-    return check_sorting_invariant_impl(root, less);
+    return check_sorting_invariant_impl(root, nullptr, nullptr, less);
+  }
+
+  // EFFECTS: Returns whether every node stores the correct height, size
+  //          and parent and, under bst_avl, whether the heights of the two
+  //          subtrees of every node differ by at most one.
+  bool check_balance_invariant() const {
+    return (root == nullptr || root->parent == nullptr)
+      && check_balance_invariant_impl(root);
   }
 
   class Iterator {
     // OVERVIEW: Iterator interface for BinarySearchTree.
     //           Iterates over the elements in ascending order as defined
     //           by the sorted ordering of the BinarySearchTree.
+    //           An Iterator is a node pointer, along with its tree so
+    //           that an end Iterator can be decremented. Incrementing it
+    //           follows child and parent links, so a full traversal
+    //           visits each link at most twice.
 
     // Big Three for Iterator not needed
 
   public:
+    // Member types so standard algorithms accept an Iterator
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T *;
+    using reference = T &;
+
     Iterator()
-      : root(nullptr), current_node(nullptr) {}
+      : tree(nullptr), current_node(nullptr) {}
 
     // EFFECTS:  Returns the current element by reference.
     // WARNING:  Dereferencing an iterator returns an element from the tree
@@ -137,8 +397,13 @@ public:
         current_node = min_element_impl(current_node->right);
       }
       else {
-        // Otherwise, look in the whole tree for the next biggest element
-        current_node = min_greater_than_impl(root, current_node->datum, less);
+        // Otherwise, climb until we arrive from a left child
+        Node *child = current_node;
+        current_node = current_node->parent;
+        while (current_node && child == current_node->right) {
+          child = current_node;
+          current_node = current_node->parent;
+        }
       }
       return *this;
     }
@@ -150,6 +415,38 @@ public:
       return result;
     }
 
+    // REQUIRES: this Iterator came from a tree that is not empty
+    // EFFECTS:  Moves to the previous element, or to an end Iterator if
+    //           this Iterator is at the minimum element. An end Iterator
+    //           moves to the maximum element.
+    // Prefix --
+    Iterator &operator--() {
+      if (current_node == nullptr) {
+        current_node = max_element_impl(tree->root);
+      }
+      else if (current_node->left) {
+        // If has left child, previous element is maximum of left subtree
+        current_node = max_element_impl(current_node->left);
+      }
+      else {
+        // Otherwise, climb until we arrive from a right child
+        Node *child = current_node;
+        current_node = current_node->parent;
+        while (current_node && child == current_node->left) {
+          child = current_node;
+          current_node = current_node->parent;
+        }
+      }
+      return *this;
+    }
+
+    // Postfix -- (implemented in terms of prefix --)
+    Iterator operator--(int) {
+      Iterator result(*this);
+      --(*this);
+      return result;
+    }
+
     bool operator==(const Iterator &rhs) const {
       return current_node == rhs.current_node;
     }
@@ -161,12 +458,13 @@ public:
   private:
     friend class BinarySearchTree;
 
-    Node *root;
+    // The tree, so that an end Iterator can be decremented, and the
+    // current node, or null for an end Iterator
+    const BinarySearchTree *tree;
     Node *current_node;
-    Compare less;
 
-    Iterator(Node *root_in, Node* current_node_in, Compare less_in)
-      : root(root_in), current_node(current_node_in), less(less_in) { }
+    Iterator(const BinarySearchTree *tree_in, Node* current_node_in)
+      : tree(tree_in), current_node(current_node_in) { }
 
   }; // BinarySearchTree::Iterator
   ////////////////////////////////////////
@@ -175,35 +473,40 @@ public:
   // EFFECTS : Returns an iterator to the first element
   //           in this BinarySearchTree.
   Iterator begin() const {
-    if (root == nullptr) {
-      return Iterator();
-    }
-    return Iterator(root, min_element_impl(root), less);
+    return Iterator(this, min_element_impl(root));
   }
 
   // EFFECTS: Returns an iterator to past-the-end.
   Iterator end() const {
-    return Iterator();
+    return Iterator(this, nullptr);
   }
 
 
   // EFFECTS: Returns an Iterator to the minimum element in this
   //          BinarySearchTree or an end Iterator if the tree is empty.
   Iterator min_element() const {
-    return Iterator(root, min_element_impl(root), less);
+    return Iterator(this, min_element_impl(root));
   }
 
   // EFFECTS: Returns an Iterator to the maximum element in this
   //          BinarySearchTree or an end Iterator if the tree is empty.
   Iterator max_element() const {
-    return Iterator(root, max_element_impl(root), less);
+    return Iterator(this, max_element_impl(root));
   }
 
   // EFFECTS: Returns an Iterator to the minimum element in this
   //          BinarySearchTree greater than the given value.
   //          If the tree is empty, returns an end Iterator.
   Iterator min_greater_than(const T &value) const {
-    return Iterator(root, min_greater_than_impl(root, value, less), less);
+    return Iterator(this, min_greater_than_impl(root, value, less));
+  }
+
+  // EFFECTS: Same as above for a value of another type. Only available
+  //          if Compare is transparent.
+  template <typename Query, typename C = Compare,
+            typename = typename C::is_transparent>
+  Iterator min_greater_than(const Query &value) const {
+    return Iterator(this, min_greater_than_impl(root, value, less));
   }
 
 
@@ -217,7 +520,114 @@ public:
   //          to the existing value. Otherwise, the sorting invariant
   //          will no longer hold.
   Iterator find(const T &query) const {
-    return Iterator(root, find_impl(root, query, less), less);
+    return Iterator(this, find_impl(root, query, less));
+  }
+
+  // EFFECTS: Same as above for a query of another type, which is compared
+  //          with the elements directly. Only available if Compare is
+  //          transparent, that is, if it defines is_transparent.
+  template <typename Query, typename C = Compare,
+            typename = typename C::is_transparent>
+  Iterator find(const Query &query) const {
+    return Iterator(this, find_impl(root, query, less));
+  }
+
+  // MODIFIES: this BinarySearchTree
+  // EFFECTS : Same as find, but as a use of the element found. Under
+  //           bst_splay, if that element, or the last element the search
+  //           reached if there is none, is deeper than twice the height of
+  //           a balanced tree, rotates it up to the root. Under the other
+  //           policies, this is the same as find.
+  Iterator access(const T &query) {
+    return access_impl(query);
+  }
+
+  // EFFECTS: Same as above for a query of another type. Only available
+  //          if Compare is transparent.
+  template <typename Query, typename C = Compare,
+            typename = typename C::is_transparent>
+  Iterator access(const Query &query) {
+    return access_impl(query);
+  }
+
+  // EFFECTS: Returns the number of elements in this BinarySearchTree that
+  //          are less than value. This is the position value has, or would
+  //          have, in sorted order.
+  size_t rank(const T &value) const {
+    return rank_impl(root, value, less);
+  }
+
+  // EFFECTS: Same as above for a value of another type. Only available
+  //          if Compare is transparent.
+  template <typename Query, typename C = Compare,
+            typename = typename C::is_transparent>
+  size_t rank(const Query &value) const {
+    return rank_impl(root, value, less);
+  }
+
+  // EFFECTS: Returns an Iterator to the element at position k (counting
+  //          from 0) in sorted order, or an end Iterator if k >= size().
+  Iterator select(size_t k) const {
+    return Iterator(this, select_impl(root, k));
+  }
+
+  // EFFECTS: Returns the number of elements e with lower <= e < upper.
+  size_t count_range(const T &lower, const T &upper) const {
+    if (!less(lower, upper)) return 0;
+    return rank(upper) - rank(lower);
+  }
+
+  // EFFECTS: Returns an Iterator to the minimum element in this
+  //          BinarySearchTree that is not less than value, or an end
+  //          Iterator if there is none.
+  Iterator lower_bound(const T &value) const {
+    return Iterator(this, lower_bound_impl(root, value, less));
+  }
+
+  // EFFECTS: Returns an Iterator to the minimum element in this
+  //          BinarySearchTree that is greater than value, or an end
+  //          Iterator if there is none. Same as min_greater_than.
+  Iterator upper_bound(const T &value) const {
+    return Iterator(this, min_greater_than_impl(root, value, less));
+  }
+
+  // EFFECTS: Returns the range of elements equivalent to value, which is
+  //          empty or holds one element: lower_bound(value) paired with
+  //          upper_bound(value).
+  std::pair<Iterator, Iterator> equal_range(const T &value) const {
+    return equal_range_impl(value);
+  }
+
+  // EFFECTS: Calls fn on every element e with lower <= e < upper, in
+  //          order. Only the nodes in that range and the paths down to
+  //          its ends are visited.
+  template <typename Function>
+  void visit_range(const T &lower, const T &upper, Function fn) const {
+    visit_range_impl(root, lower, upper, fn, less);
+  }
+
+  // Same as the four functions above for values of another type. Only
+  // available if Compare is transparent.
+  template <typename Query, typename C = Compare,
+            typename = typename C::is_transparent>
+  Iterator lower_bound(const Query &value) const {
+    return Iterator(this, lower_bound_impl(root, value, less));
+  }
+  template <typename Query, typename C = Compare,
+            typename = typename C::is_transparent>
+  Iterator upper_bound(const Query &value) const {
+    return Iterator(this, min_greater_than_impl(root, value, less));
+  }
+  template <typename Query, typename C = Compare,
+            typename = typename C::is_transparent>
+  std::pair<Iterator, Iterator> equal_range(const Query &value) const {
+    return equal_range_impl(value);
+  }
+  template <typename Query, typename Function, typename C = Compare,
+            typename = typename C::is_transparent>
+  void visit_range(const Query &lower, const Query &upper,
+                   Function fn) const {
+    visit_range_impl(root, lower, upper, fn, less);
   }
 
   // REQUIRES: The given item is not already contained in this BinarySearchTree
@@ -226,8 +636,142 @@ public:
   //           the sorting invariant.
   Iterator insert(const T &item) {
     assert(find(item) == end());
-    root = insert_impl(root, item, less);
-    return find(item);
+    return emplace(item).first;
+  }
+
+  // REQUIRES: The given item is not already contained in this BinarySearchTree
+  // MODIFIES: this BinarySearchTree, item
+  // EFFECTS : Moves item into this BinarySearchTree, maintaining the
+  //           sorting invariant.
+  Iterator insert(T &&item) {
+    assert(find(item) == end());
+    return emplace(std::move(item)).first;
+  }
+
+  // MODIFIES: this BinarySearchTree
+  // EFFECTS : Constructs an element from args in place and inserts it,
+  //           maintaining the sorting invariant. If an equivalent element
+  //           is already present, the new one is destroyed instead.
+  //           Returns an Iterator to the element equivalent to the new one,
+  //           and whether the new one was inserted.
+  template <typename... Args>
+  std::pair<Iterator, bool> emplace(Args&&... args) {
+    Node *node = create_node(std::forward<Args>(args)...);
+    Node *parent = nullptr;
+    Node *existing = descend_impl(node->datum, parent);
+    if (existing) {
+      destroy_node(node);
+      splay_deep_impl(existing, Balance());
+      return std::make_pair(Iterator(this, existing), false);
+    }
+    attach_impl(node, parent);
+    splay_impl(node, Balance());
+    return std::make_pair(Iterator(this, node), true);
+  }
+
+  // MODIFIES: this BinarySearchTree
+  // EFFECTS : Searches for an element equivalent to query, which may be
+  //           of any type that Compare can compare with T. If one is
+  //           found, returns an Iterator to it and false. Otherwise,
+  //           constructs an element from args, which must be equivalent
+  //           to query (args may move from query), inserts it where the
+  //           search ended, and returns an Iterator to it and true.
+  //           Either way the tree is descended only once, and nothing is
+  //           constructed if query is found.
+  template <typename Query, typename... Args>
+  std::pair<Iterator, bool> find_or_insert(const Query &query,
+                                           Args&&... args) {
+    Node *parent = nullptr;
+    Node *existing = descend_impl(query, parent);
+    if (existing) {
+      splay_deep_impl(existing, Balance());
+      return std::make_pair(Iterator(this, existing), false);
+    }
+    Node *node = create_node(std::forward<Args>(args)...);
+    attach_impl(node, parent);
+    splay_impl(node, Balance());
+    return std::make_pair(Iterator(this, node), true);
+  }
+
+  // REQUIRES: position is a dereferenceable Iterator into this tree
+  // MODIFIES: this BinarySearchTree
+  // EFFECTS : Removes the element at position, rebalancing according to
+  //           the Balance policy, and returns an Iterator to the element
+  //           after it. Iterators to other elements stay valid.
+  Iterator erase(Iterator position) {
+    Node *node = position.current_node;
+    ++position;
+    detach_impl(node);
+    destroy_node(node);
+    return position;
+  }
+
+  // MODIFIES: this BinarySearchTree
+  // EFFECTS : Removes the element equivalent to value, if there is one.
+  //           Returns the number of elements removed.
+  size_t erase(const T &value) {
+    return erase_impl(value);
+  }
+
+  // EFFECTS: Same as above for a value of another type. Only available
+  //          if Compare is transparent.
+  template <typename Query, typename C = Compare,
+            typename = typename C::is_transparent>
+  size_t erase(const Query &value) {
+    return erase_impl(value);
+  }
+
+  // MODIFIES: this BinarySearchTree
+  // EFFECTS : Adds a copy of every element of other that has no
+  //           equivalent here. Same as the merge below with a combine
+  //           that does nothing.
+  void merge(const BinarySearchTree &other) {
+    merge(other, [](T &, const T &) { });
+  }
+
+  // MODIFIES: this BinarySearchTree
+  // EFFECTS : Adds a copy of every element of other that has no
+  //           equivalent here, and calls combine(mine, theirs) for every
+  //           pair of equivalent elements, which may update mine as long
+  //           as it still compares equal. Runs in O(n + m) time by walking
+  //           both trees in order and relinking the result into a
+  //           perfectly balanced tree. The nodes of this tree are reused,
+  //           so Iterators into it stay valid.
+  template <typename Combine>
+  void merge(const BinarySearchTree &other, Combine combine) {
+    if (this == &other || other.empty()) return;
+    std::vector<Node *> merged;
+    merged.reserve(size() + other.size());
+    Created_nodes created(*this);
+    created.nodes.reserve(other.size());
+    Iterator mine = begin();
+    Iterator theirs = other.begin();
+    while (mine != end() || theirs != other.end()) {
+      if (theirs == other.end() || (mine != end() && less(*mine, *theirs))) {
+        merged.push_back(mine.current_node);
+        ++mine;
+      }
+      else if (mine == end() || less(*theirs, *mine)) {
+        created.nodes.push_back(create_node(*theirs));
+        merged.push_back(created.nodes.back());
+        ++theirs;
+      }
+      else {
+        combine(*mine, *theirs);
+        merged.push_back(mine.current_node);
+        ++mine;
+        ++theirs;
+      }
+    }
+    root = link_nodes_impl(merged, 0, merged.size(), nullptr);
+    created.nodes.clear();
+  }
+
+  // EFFECTS: Returns a read-only copy of this BinarySearchTree in a
+  //          layout that is faster to search. The copy does not change
+  //          when this tree does.
+  FrozenTree<T, Compare> freeze() const {
+    return FrozenTree<T, Compare>(begin(), end(), less);
   }
 
   // EFFECTS: Returns a human-readable string representation of this
@@ -247,6 +791,22 @@ private:
   // An instance of the Compare type. Use this to compare elements.
   Compare less;
 
+  // Where the nodes of this tree are allocated, chosen by the Nodes policy.
+  using Storage = typename Nodes::template storage<Node>;
+  Storage nodes;
+
+  // How tree_links reaches the links of a Node, so that relinking and
+  // rebalancing are shared with IntrusiveTree
+  struct Node_link_access {
+    using Node = BinarySearchTree::Node;
+    static Node *& left(Node *node) { return node->left; }
+    static Node *& right(Node *node) { return node->right; }
+    static Node *& parent(Node *node) { return node->parent; }
+    static int height(const Node *node) { return node_height(node); }
+    static void update(Node *node) { update_impl(node); }
+  };
+  using Node_links = tree_links<Node_link_access>;
+
     
   // NOTE: These member types are implemented for you in TreePrint.h.
   //       They support the to_string function. You do not have to do
@@ -273,58 +833,152 @@ private:
     }
   }
 
-  // EFFECTS: Returns the size of the tree rooted at 'node', which is the
-  //          total number of nodes in that tree. The size of an empty
-  //          tree is 0.
-  // NOTE:    This function must be tree recursive.
-  static int size_impl(const Node *node) {
-    if (node == 0) return 0;
-    return (size_impl(node->left) + size_impl(node->right)) + 1;
+  // EFFECTS: Allocates a single-element tree whose element is
+  //          constructed from 'args'.
+  template <typename... Args>
+  Node * create_node(Args&&... args) {
+    void *slot = nodes.allocate();
+    try {
+      return new (slot) Node(std::forward<Args>(args)...);
+    }
+    catch (...) {
+      nodes.deallocate(slot);
+      throw;
+    }
   }
 
-  // EFFECTS: Returns the height of the tree rooted at 'node', which is the
-  //          number of nodes in the longest path from the 'node' to a leaf.
-  //          The height of an empty tree is 0.
-  // NOTE:    This function must be tree recursive.
-  static int height_impl(const Node *node) {
-    if (node == 0) return 0;
-    return (std::max(height_impl(node->left), height_impl(node->right)) + 1);
+  // EFFECTS: Destroys 'node' and gives its memory back to the storage.
+  void destroy_node(Node *node) {
+    node->~Node();
+    nodes.deallocate(node);
   }
 
+  // Nodes created for a tree but not yet linked into it. Any still held
+  // when this goes out of scope are destroyed, so that they do not leak
+  // if an exception stops the tree from taking them.
+  struct Created_nodes {
+    BinarySearchTree &tree;
+    std::vector<Node *> nodes;
+
+    explicit Created_nodes(BinarySearchTree &tree_in) : tree(tree_in) { }
+
+    ~Created_nodes() {
+      for (Node *node : nodes) {
+        tree.destroy_node(node);
+      }
+    }
+
+    Created_nodes(const Created_nodes &) = delete;
+    Created_nodes & operator=(const Created_nodes &) = delete;
+  };
+
   // EFFECTS: Creates and returns a pointer to the root of a new node structure
   //          with the same elements and EXACTLY the same structure as the
-  //          tree rooted at 'node'.
+  //          tree rooted at 'node', whose root has 'parent' as its parent.
   // NOTE:    This function must be tree recursive.
-  static Node *copy_nodes_impl(Node *node) {
+  Node *copy_nodes_impl(const Node *node, Node *parent) {
     if (node == 0) return nullptr;
     else {
-      Node *new_node = new Node;
-      new_node->datum = node->datum;
-      new_node->left = copy_nodes_impl(node->left);
-      new_node->right = copy_nodes_impl(node->right);
+      Node *new_node = create_node(node->datum);
+      new_node->parent = parent;
+      new_node->left = copy_nodes_impl(node->left, new_node);
+      new_node->right = copy_nodes_impl(node->right, new_node);
+      new_node->height = node->height;
+      new_node->subtree_size = node->subtree_size;
       return new_node;
     }
   }
 
+  // MODIFIES: this BinarySearchTree
+  // EFFECTS: Replaces the contents with the elements of the forward range
+  //          [first, last), which is read twice: once to count it and once
+  //          to build the tree.
+  template <typename Iter>
+  void assign_impl(Iter first, Iter last, std::forward_iterator_tag) {
+    clear();
+    size_t n = static_cast<size_t>(std::distance(first, last));
+    root = build_impl(first, n, nullptr);
+  }
+
+  // MODIFIES: this BinarySearchTree
+  // EFFECTS: Same as above for an input range, which is moved through a
+  //          buffer since it can only be read once.
+  template <typename Iter>
+  void assign_impl(Iter first, Iter last, std::input_iterator_tag) {
+    std::vector<T> buffer(first, last);
+    assign_impl(std::make_move_iterator(buffer.begin()),
+                std::make_move_iterator(buffer.end()),
+                std::forward_iterator_tag());
+  }
+
+  // REQUIRES: 'first' can be advanced 'n' times
+  // MODIFIES: first
+  // EFFECTS: Builds a perfectly balanced tree from the next 'n' elements
+  //          of 'first', whose root has 'parent' as its parent, and
+  //          advances 'first' past them. Nodes are created in order, so
+  //          each element is read once.
+  // NOTE:    This function must be tree recursive.
+  template <typename Iter>
+  Node * build_impl(Iter &first, size_t n, Node *parent) {
+    if (n == 0) return nullptr;
+    size_t left_size = n / 2;
+    Node *left = build_impl(first, left_size, nullptr);
+    Node *node = create_node(*first);
+    ++first;
+    node->parent = parent;
+    node->left = left;
+    if (left) left->parent = node;
+    node->right = build_impl(first, n - left_size - 1, node);
+    update_impl(node);
+    return node;
+  }
+
+  // MODIFIES: the nodes in sorted[first, last)
+  // EFFECTS: Links sorted[first, last), which are in sorted order, into a
+  //          perfectly balanced tree whose root has 'parent' as its
+  //          parent, and returns that root.
+  // NOTE:    This function must be tree recursive.
+  static Node * link_nodes_impl(const std::vector<Node *> &sorted,
+                                size_t first, size_t last, Node *parent) {
+    if (first == last) return nullptr;
+    size_t middle = first + (last - first) / 2;
+    Node *node = sorted[middle];
+    node->parent = parent;
+    node->left = link_nodes_impl(sorted, first, middle, node);
+    node->right = link_nodes_impl(sorted, middle + 1, last, node);
+    update_impl(node);
+    return node;
+  }
+
   // EFFECTS: Frees the memory for all nodes used in the tree rooted at 'node'.
   // NOTE:    This function must be tree recursive.
-  static void destroy_nodes_impl(Node *node) {
+  void destroy_nodes_impl(Node *node) {
     if (node == nullptr) {
       return;
     }
     else {
     destroy_nodes_impl(node->left);
     destroy_nodes_impl(node->right);
-    delete node;
+    destroy_node(node);
     }
   }
 
+  // EFFECTS: Runs the destructor of every element in the tree rooted at
+  //          'node' without freeing any memory.
+  static void destroy_data_impl(Node *node) {
+    if (node == nullptr) return;
+    destroy_data_impl(node->left);
+    destroy_data_impl(node->right);
+    node->~Node();
+  }
+
   // EFFECTS : Searches the tree rooted at 'node' for an element equivalent
   //           to 'query'. If one is found, returns a pointer to the node
   //           containing it. If the tree is empty or the element is not
   //           found, returns a null pointer.
   //
-  static Node * find_impl(Node *node, const T &query, Compare less) {
+  template <typename Query>
+  static Node * find_impl(Node *node, const Query &query, Compare less) {
     if (node == 0) return nullptr;
     else if (!less(node->datum, query) && !less(query, node->datum)) {
       return node;
@@ -340,40 +994,247 @@ private:
     return nullptr;
   }
 
-  // REQUIRES: item is not already contained in the tree rooted at 'node'
-  // MODIFIES: the tree rooted at 'node'
-  // EFFECTS : If 'node' represents an empty tree, allocates a newexit
-  //           Node to represent a single-element tree with 'item' as
-  //           its only element and returns a pointer to the new Node.
-  //           If the tree rooted at 'node' is not empty, inserts
-  //           'item' into the proper location as a leaf in the
-  //           existing tree structure according to the sorting
-  //           invariant and returns the original parameter 'node'.
-  static Node * insert_impl(Node *node, const T &item, Compare less) {
-    if (node == nullptr) {
-      Node *new_node = new Node;
-      new_node->datum = item;
-      new_node->left = nullptr;
-      new_node->right = nullptr;
-      return new_node;
-    }
-    else {
-      if (less(item, node->datum)) {
-        node->left = insert_impl(node->left, item, less);
-        return node;
+  // EFFECTS : Implements equal_range for any type of value.
+  template <typename Query>
+  std::pair<Iterator, Iterator> equal_range_impl(const Query &value) const {
+    Iterator first(this, lower_bound_impl(root, value, less));
+    Iterator last = first;
+    if (first != end() && !less(value, *first)) ++last;
+    return std::make_pair(first, last);
+  }
+
+  // MODIFIES: this BinarySearchTree
+  // EFFECTS : Implements erase for any type of value.
+  template <typename Query>
+  size_t erase_impl(const Query &value) {
+    Node *node = find_impl(root, value, less);
+    if (node == nullptr) return 0;
+    detach_impl(node);
+    destroy_node(node);
+    return 1;
+  }
+
+  // MODIFIES: parent
+  // EFFECTS : Walks down from the root looking for an element equivalent
+  //           to 'query'. Returns its node if there is one. Otherwise
+  //           returns a null pointer and sets 'parent' to the node below
+  //           which an element equivalent to 'query' belongs, or to null
+  //           if the tree is empty.
+  template <typename Query>
+  Node * descend_impl(const Query &query, Node *&parent) {
+    Node *node = root;
+    parent = nullptr;
+    while (node) {
+      if (less(query, node->datum)) {
+        parent = node;
+        node = node->left;
+      }
+      else if (less(node->datum, query)) {
+        parent = node;
+        node = node->right;
       }
-      else if (less(node->datum, item)) {
-        node->right = insert_impl(node->right, item, less);
+      else {
         return node;
-        }
-      return nullptr;
+      }
+    }
+    return nullptr;
+  }
+
+  // REQUIRES: 'node' is a single-element tree, and 'parent' is what
+  //           descend_impl found for its element
+  // MODIFIES: this BinarySearchTree
+  // EFFECTS : Links 'node' in as a child of 'parent', then walks back up
+  //           to the root, updating each node on the way and rebalancing
+  //           it according to the Balance policy.
+  void attach_impl(Node *node, Node *parent) {
+    node->parent = parent;
+    if (parent == nullptr) {
+      root = node;
+      return;
     }
+    if (less(node->datum, parent->datum)) parent->left = node;
+    else parent->right = node;
+    retrace_impl(parent);
+  }
+
+  // MODIFIES: this BinarySearchTree
+  // EFFECTS : Unlinks 'node' from the tree, putting its in-order successor
+  //           in its place if it has two children, and rebalances. The
+  //           other nodes are relinked rather than having their elements
+  //           moved, so Iterators to them stay valid.
+  void detach_impl(Node *node) {
+    retrace_impl(Node_links::unlink(root, node));
+  }
+
+  // MODIFIES: this BinarySearchTree
+  // EFFECTS : Walks from 'node' up to the root, updating each node on the
+  //           way and rebalancing it according to the Balance policy.
+  void retrace_impl(Node *node) {
+    Node_links::retrace(root, node, [](Node *subtree) {
+      return rebalance_impl(subtree, Balance());
+    });
+  }
+
+  // MODIFIES: this BinarySearchTree
+  // EFFECTS : Implements access for any type of query.
+  template <typename Query>
+  Iterator access_impl(const Query &query) {
+    Node *parent = nullptr;
+    Node *existing = descend_impl(query, parent);
+    splay_deep_impl(existing ? existing : parent, Balance());
+    return Iterator(this, existing);
+  }
+
+  // EFFECTS : Under the other policies, leaves the tree as is.
+  template <typename Policy>
+  void splay_deep_impl(Node *, Policy) { }
+
+  // MODIFIES: this BinarySearchTree
+  // EFFECTS : Splays 'node', if not null, when its depth is more than
+  //           twice the height of a perfectly balanced tree of this size.
+  //           A lookup that stops above that depth already cost O(log n),
+  //           so leaving the tree as is keeps access() O(log n) amortized
+  //           and spares the rotations when frequently used elements are
+  //           already near the top.
+  void splay_deep_impl(Node *node, bst_splay) {
+    if (node == nullptr) return;
+    size_t balanced_height = 0;
+    while ((size_t(1) << balanced_height) <= root->subtree_size) {
+      ++balanced_height;
+    }
+    size_t depth = 1;
+    for (Node *above = node->parent; above; above = above->parent) {
+      if (++depth > 2 * balanced_height) {
+        splay_impl(node, bst_splay());
+        return;
+      }
+    }
+  }
+
+  // EFFECTS : Under the other policies, leaves the tree as is.
+  template <typename Policy>
+  void splay_impl(Node *, Policy) { }
+
+  // MODIFIES: this BinarySearchTree
+  // EFFECTS : Rotates 'node', if not null, up to the root two levels at a
+  //           time, which roughly halves the depth of every node on its
+  //           path.
+  void splay_impl(Node *node, bst_splay) {
+    if (node == nullptr) return;
+    while (node->parent) {
+      Node *parent = node->parent;
+      Node *grandparent = parent->parent;
+      if (grandparent == nullptr) {
+        // Zig: node is a child of the root
+        rotate_up_impl(node);
+      }
+      else if ((grandparent->left == parent) == (parent->left == node)) {
+        // Zig-zig: rotate the parent first, then node
+        rotate_up_impl(parent);
+        rotate_up_impl(node);
+      }
+      else {
+        // Zig-zag: rotate node twice
+        rotate_up_impl(node);
+        rotate_up_impl(node);
+      }
+    }
+  }
+
+  // REQUIRES: 'node' is not the root
+  // MODIFIES: this BinarySearchTree
+  // EFFECTS : Rotates 'node' above its parent, fixing the link from the
+  //           grandparent or the root.
+  void rotate_up_impl(Node *node) {
+    Node *parent = node->parent;
+    Node *above = parent->parent;
+    bool is_left = above && above->left == parent;
+    if (parent->left == node) Node_links::rotate_right(parent);
+    else Node_links::rotate_left(parent);
+    if (above == nullptr) root = node;
+    else if (is_left) above->left = node;
+    else above->right = node;
+  }
+
+  // EFFECTS : Returns the stored height of the tree rooted at 'node',
+  //           which is 0 for an empty tree.
+  static int node_height(const Node *node) {
+    return node ? node->height : 0;
+  }
+
+  // EFFECTS : Returns the stored number of elements in the tree rooted at
+  //           'node', which is 0 for an empty tree.
+  static size_t node_size(const Node *node) {
+    return node ? node->subtree_size : 0;
+  }
+
+  // MODIFIES: node
+  // EFFECTS : Recomputes the height and size of 'node' from its children.
+  static void update_impl(Node *node) {
+    node->height = std::max(node_height(node->left),
+                            node_height(node->right)) + 1;
+    node->subtree_size = node_size(node->left) + node_size(node->right) + 1;
+  }
+
+  // EFFECTS : Returns the number of elements in the tree rooted at 'node'
+  //           that are less than 'value'.
+  template <typename Query>
+  static size_t rank_impl(const Node *node, const Query &value,
+                          Compare less) {
+    if (node == nullptr) return 0;
+    if (less(node->datum, value)) {
+      return node_size(node->left) + 1 + rank_impl(node->right, value, less);
+    }
+    return rank_impl(node->left, value, less);
+  }
+
+  // EFFECTS : Returns a pointer to the Node at position 'k' in sorted order
+  //           within the tree rooted at 'node', or a null pointer if 'k' is
+  //           not less than the size of that tree.
+  static Node * select_impl(Node *node, size_t k) {
+    if (node == nullptr) return nullptr;
+    size_t left = node_size(node->left);
+    if (k < left) return select_impl(node->left, k);
+    if (k == left) return node;
+    return select_impl(node->right, k - left - 1);
+  }
+
+  // EFFECTS : Under bst_unbalanced, leaves the tree rooted at 'node' as is.
+  static Node * rebalance_impl(Node *node, bst_unbalanced) {
+    return node;
+  }
+
+  // EFFECTS : Under bst_splay, leaves the tree rooted at 'node' as is.
+  //           Insertions splay afterwards instead.
+  static Node * rebalance_impl(Node *node, bst_splay) {
+    return node;
+  }
+
+  // REQUIRES: the subtrees of 'node' are AVL trees whose heights differ by
+  //           at most two
+  // MODIFIES: the tree rooted at 'node'
+  // EFFECTS : Restores the AVL invariant at 'node' with one or two
+  //           rotations and returns the new root of the subtree.
+  static Node * rebalance_impl(Node *node, bst_avl) {
+    return Node_links::rebalance_avl(node);
+  }
+
+  // EFFECTS : Returns whether subtrees of heights 'left' and 'right' are
+  //           allowed under the Balance policy.
+  static bool is_balanced(int, int, bst_unbalanced) {
+    return true;
+  }
+  static bool is_balanced(int left, int right, bst_avl) {
+    return left - right <= 1 && right - left <= 1;
+  }
+  static bool is_balanced(int, int, bst_splay) {
+    return true;
   }
 
   // EFFECTS : Returns a pointer to the Node containing the minimum element
   //           in the tree rooted at 'node' or a null pointer if the tree is empty.
   static Node * min_element_impl(Node *node) {
-    if (node->left == nullptr) return node;
+    if (node == nullptr || node->left == nullptr) return node;
     else {
       return (min_element_impl(node->left));
     }
@@ -382,7 +1243,7 @@ private:
   // EFFECTS : Returns a pointer to the Node containing the maximum element
   //           in the tree rooted at 'node' or a null pointer if the tree is empty.
   static Node * max_element_impl(Node *node) {
-    if (node->right == nullptr) return node;
+    if (node == nullptr || node->right == nullptr) return node;
     else {
       return (max_element_impl(node->right));
     }
@@ -390,30 +1251,35 @@ private:
 
 
   // EFFECTS: Returns whether the sorting invariant holds on the tree
-  //          rooted at 'node'.
+  //          rooted at 'node', and whether every element in it is greater
+  //          than *lower and less than *upper. A null bound is unbounded.
   // NOTE:    This function must be tree recursive.
-  static bool check_sorting_invariant_impl(const Node *node, Compare less) {
+  static bool check_sorting_invariant_impl(const Node *node, const T *lower,
+                                           const T *upper, Compare less) {
     if (node == 0) return true;
-    else {
-      if (node->left) {
-        if (less(node->left->datum, node->datum)) {
-          return check_sorting_invariant_impl(node->left, less);
-        }
-        else {
-          return false;
-        }
-        return check_sorting_invariant_impl(node->left, less);
-      }
-      if (node->right) {
-        if (less(node->datum, node->right->datum)) {
-          return check_sorting_invariant_impl(node->right, less);
-      }
-        else {
-          return false;
-        }
-      }
-      return check_sorting_invariant_impl(node->right, less);
+    if (lower && !less(*lower, node->datum)) return false;
+    if (upper && !less(node->datum, *upper)) return false;
+    return check_sorting_invariant_impl(node->left, lower, &node->datum, less)
+      && check_sorting_invariant_impl(node->right, &node->datum, upper, less);
+  }
+
+  // EFFECTS: Returns whether the heights, sizes and parents stored in the
+  //          tree rooted at 'node' are correct and satisfy the Balance policy.
+  // NOTE:    This function must be tree recursive.
+  static bool check_balance_invariant_impl(const Node *node) {
+    if (node == nullptr) return true;
+    if (node->left && node->left->parent != node) return false;
+    if (node->right && node->right->parent != node) return false;
+    int left = node_height(node->left);
+    int right = node_height(node->right);
+    if (node->height != std::max(left, right) + 1) return false;
+    if (node->subtree_size !=
+        node_size(node->left) + node_size(node->right) + 1) {
+      return false;
     }
+    if (!is_balanced(left, right, Balance())) return false;
+    return check_balance_invariant_impl(node->left)
+      && check_balance_invariant_impl(node->right);
   }
 
   // EFFECTS : Traverses the tree rooted at 'node' using an in-order traversal,
@@ -441,12 +1307,48 @@ private:
     }
   }
 
+  // EFFECTS : Returns a pointer to the Node containing the smallest element
+  //           in the tree rooted at 'node' that is not less than 'val', or
+  //           a null pointer if there is none.
+  template <typename Query>
+  static Node * lower_bound_impl(Node *node, const Query &val,
+                                 Compare less) {
+    Node *result = nullptr;
+    while (node) {
+      if (less(node->datum, val)) {
+        node = node->right;
+      }
+      else {
+        result = node;
+        node = node->left;
+      }
+    }
+    return result;
+  }
+
+  // EFFECTS : Calls 'fn' on every element e in the tree rooted at 'node'
+  //           with lower <= e < upper, in order, skipping subtrees that
+  //           lie outside that range.
+  template <typename Query, typename Function>
+  static void visit_range_impl(Node *node, const Query &lower,
+                               const Query &upper, Function &fn,
+                               Compare less) {
+    if (node == nullptr) return;
+    bool above_lower = !less(node->datum, lower);
+    bool below_upper = less(node->datum, upper);
+    if (above_lower) visit_range_impl(node->left, lower, upper, fn, less);
+    if (above_lower && below_upper) fn(node->datum);
+    if (below_upper) visit_range_impl(node->right, lower, upper, fn, less);
+  }
+
   // EFFECTS : Returns a pointer to the Node containing the smallest element
   //           in the tree rooted at 'node' that is greater than 'val'.
   //           Returns a null pointer if the tree is empty or if it does not
   //           contain any elements that are greater than 'val'.
   //
-  static Node * min_greater_than_impl(Node *node, const T &val, Compare less) {
+  template <typename Query>
+  static Node * min_greater_than_impl(Node *node, const Query &val,
+                                      Compare less) {
     if (node == 0) return nullptr;
 
     else if (!less(val, node->datum)) {
@@ -472,9 +1374,10 @@ private:
 //           in-order traversal, and an initial "[" and trailing "]"
 //           are printed before the first and after the last element.
 //           Does not print a newline. Returns os.
-template <typename T, typename Compare>
+template <typename T, typename Compare, typename Balance, typename Nodes>
 std::ostream &operator<<(std::ostream &os,
-                         const BinarySearchTree<T, Compare> &tree) {
+                         const BinarySearchTree<T, Compare, Balance,
+                                                Nodes> &tree) {
   os << "[ ";
   for (T& elt : tree) {
     os << elt << " ";
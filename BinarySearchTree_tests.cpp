@@ -3,6 +3,12 @@
 #include <sstream>
 #include <cstring>
 #include <cmath>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <type_traits>
+#include <iterator>
+#include <stdexcept>
 
 #include "BinarySearchTree.h"
 #include "unit_test_framework.h"
@@ -237,5 +243,619 @@ TEST(test_min_greater_than) {
     ASSERT_EQUAL(bst.min_greater_than(12), bst.end());
 }
 
+TEST(test_check_sorting_invariant_deep) {
+    BinarySearchTree<int> bst;
+    bst.insert(5);
+    bst.insert(3);
+    bst.insert(4);
+    ASSERT_TRUE(bst.check_sorting_invariant());
+    // 6 is still greater than its parent 3, but not less than the root 5
+    *bst.find(4) = 6;
+    ASSERT_FALSE(bst.check_sorting_invariant());
+}
+
+TEST(test_avl_sorted_insert) {
+    BinarySearchTree<int, std::less<int>, bst_avl> bst;
+    for (int i = 0; i < 1000; ++i) {
+        bst.insert(i);
+        ASSERT_TRUE(bst.check_balance_invariant());
+    }
+    ASSERT_TRUE(bst.check_sorting_invariant());
+    ASSERT_EQUAL(bst.size(), 1000);
+    // A full tree of height 10 holds 1023 elements
+    ASSERT_EQUAL(bst.height(), 10);
+    for (int i = 999; i >= 0; --i) {
+        ASSERT_EQUAL(*bst.find(i), i);
+    }
+    int expected = 0;
+    for (int i : bst) {
+        ASSERT_EQUAL(i, expected++);
+    }
+}
+
+TEST(test_avl_rotations) {
+    BinarySearchTree<int, std::less<int>, bst_avl> bst;
+    bst.insert(3);
+    bst.insert(1);
+    bst.insert(2);
+    ostringstream fout;
+    bst.traverse_preorder(fout);
+    ASSERT_EQUAL(fout.str(), "2 1 3 ");
+    bst.insert(5);
+    bst.insert(4);
+    fout.str("");
+    bst.traverse_preorder(fout);
+    ASSERT_EQUAL(fout.str(), "2 1 4 3 5 ");
+    ASSERT_TRUE(bst.check_balance_invariant());
+
+    BinarySearchTree<int, std::less<int>, bst_avl> copy(bst);
+    ASSERT_TRUE(copy.check_balance_invariant());
+    ASSERT_EQUAL(copy.height(), 3);
+}
+
+TEST(test_unbalanced_heights) {
+    BinarySearchTree<int> bst;
+    bst.insert(1);
+    bst.insert(2);
+    bst.insert(3);
+    ASSERT_TRUE(bst.check_balance_invariant());
+    ASSERT_EQUAL(bst.height(), 3);
+}
+
+TEST(test_iterator_increment_decrement) {
+    BinarySearchTree<int> bst;
+    for (int i : {50, 20, 80, 10, 30, 70, 90, 25, 35, 75}) {
+        bst.insert(i);
+    }
+    vector<int> forward;
+    for (auto it = bst.begin(); it != bst.end(); ++it) {
+        forward.push_back(*it);
+    }
+    ASSERT_EQUAL(forward, vector<int>({10, 20, 25, 30, 35, 50, 70, 75, 80, 90}));
+
+    vector<int> backward;
+    auto it = bst.max_element();
+    while (it != bst.end()) {
+        backward.push_back(*it--);
+    }
+    ASSERT_EQUAL(backward, vector<int>({90, 80, 75, 70, 50, 35, 30, 25, 20, 10}));
+
+    it = bst.find(35);
+    ASSERT_EQUAL(*--it, 30);
+    ASSERT_EQUAL(*++++it, 50);
+}
+
+TEST(test_decrement_end) {
+    BinarySearchTree<int, less<int>, bst_splay> bst;
+    for (int i : {50, 20, 80, 10, 30}) {
+        bst.insert(i);
+    }
+    BinarySearchTree<int, less<int>, bst_splay>::Iterator end = bst.end();
+    ASSERT_EQUAL(*--end, 80);
+    ASSERT_EQUAL(*prev(bst.end()), 80);
+
+    // The root changes as elements are inserted, and end() follows it
+    end = bst.end();
+    bst.insert(90);
+    ASSERT_EQUAL(*--end, 90);
+
+    vector<int> backward(
+        reverse_iterator<BinarySearchTree<int, less<int>,
+                                          bst_splay>::Iterator>(bst.end()),
+        reverse_iterator<BinarySearchTree<int, less<int>,
+                                          bst_splay>::Iterator>(bst.begin()));
+    ASSERT_EQUAL(backward, vector<int>({90, 80, 50, 30, 20, 10}));
+}
+
+TEST(test_iterator_after_rotations) {
+    BinarySearchTree<int, std::less<int>, bst_avl> bst;
+    for (int i = 100; i > 0; --i) {
+        bst.insert(i);
+    }
+    ASSERT_TRUE(bst.check_balance_invariant());
+    int expected = 1;
+    for (int i : bst) {
+        ASSERT_EQUAL(i, expected++);
+    }
+    ASSERT_EQUAL(expected, 101);
+    BinarySearchTree<int, std::less<int>, bst_avl> copy(bst);
+    ASSERT_TRUE(copy.check_balance_invariant());
+    ASSERT_EQUAL(*--copy.max_element(), 99);
+}
+
+TEST(test_empty_min_max) {
+    BinarySearchTree<int> bst;
+    ASSERT_EQUAL(bst.min_element(), bst.end());
+    ASSERT_EQUAL(bst.max_element(), bst.end());
+    ASSERT_EQUAL(bst.begin(), bst.end());
+}
+
+TEST(test_rank_select) {
+    BinarySearchTree<int, std::less<int>, bst_avl> bst;
+    for (int i = 0; i < 200; i += 2) {
+        bst.insert(i);
+    }
+    ASSERT_EQUAL(bst.size(), 100);
+    ASSERT_TRUE(bst.check_balance_invariant());
+    ASSERT_EQUAL(bst.rank(-1), 0);
+    ASSERT_EQUAL(bst.rank(0), 0);
+    ASSERT_EQUAL(bst.rank(1), 1);
+    ASSERT_EQUAL(bst.rank(100), 50);
+    ASSERT_EQUAL(bst.rank(1000), 100);
+    for (size_t k = 0; k < 100; ++k) {
+        ASSERT_EQUAL(*bst.select(k), static_cast<int>(2 * k));
+    }
+    ASSERT_EQUAL(bst.select(100), bst.end());
+    ASSERT_EQUAL(bst.count_range(10, 20), 5);
+    ASSERT_EQUAL(bst.count_range(11, 21), 5);
+    ASSERT_EQUAL(bst.count_range(20, 10), 0);
+}
+
+TEST(test_rank_select_unbalanced) {
+    BinarySearchTree<int> bst;
+    for (int i : {5, 2, 8, 1, 9, 3}) {
+        bst.insert(i);
+    }
+    ASSERT_TRUE(bst.check_balance_invariant());
+    ASSERT_EQUAL(bst.rank(8), 4);
+    ASSERT_EQUAL(*bst.select(2), 3);
+    ASSERT_EQUAL(bst.count_range(2, 9), 4);
+}
+
+TEST(test_pool_nodes) {
+    BinarySearchTree<int, less<int>, bst_avl, bst_pool_nodes> bst;
+    for (int i = 0; i < 5000; ++i) {
+        bst.insert(i);
+    }
+    ASSERT_EQUAL(bst.size(), 5000);
+    ASSERT_TRUE(bst.check_balance_invariant());
+
+    BinarySearchTree<int, less<int>, bst_avl, bst_pool_nodes> copy(bst);
+    bst.clear();
+    ASSERT_TRUE(bst.empty());
+    ASSERT_EQUAL(copy.size(), 5000);
+    ASSERT_EQUAL(*copy.select(4321), 4321);
+
+    // Slabs are allocated again after a clear
+    bst.insert(7);
+    bst = copy;
+    ASSERT_EQUAL(bst.size(), 5000);
+    ASSERT_TRUE(bst.check_sorting_invariant());
+}
+
+TEST(test_pool_nodes_strings) {
+    // Elements with destructors are destroyed before the slabs are freed
+    BinarySearchTree<string, less<string>, bst_unbalanced,
+                     bst_pool_nodes> bst;
+    for (int i = 0; i < 100; ++i) {
+        bst.insert(string(40, char('a' + i % 26)) + to_string(i));
+    }
+    ASSERT_EQUAL(bst.size(), 100);
+    bst.clear();
+    bst.insert("euchre");
+    ASSERT_EQUAL(*bst.begin(), "euchre");
+}
+
+TEST(test_build_sorted) {
+    for (int n = 0; n < 40; ++n) {
+        vector<int> sorted;
+        for (int i = 0; i < n; ++i) {
+            sorted.push_back(3 * i);
+        }
+        BinarySearchTree<int, less<int>, bst_avl> bst(sorted.begin(),
+                                                      sorted.end());
+        ASSERT_EQUAL(bst.size(), n);
+        ASSERT_TRUE(bst.check_sorting_invariant());
+        ASSERT_TRUE(bst.check_balance_invariant());
+        ASSERT_TRUE(equal(bst.begin(), bst.end(), sorted.begin()));
+        // Perfectly balanced: height is floor(log2(n)) + 1
+        size_t height = 0;
+        while ((size_t(1) << height) <= size_t(n)) {
+            ++height;
+        }
+        ASSERT_EQUAL(bst.height(), height);
+    }
+}
+
+TEST(test_build_from_input_range) {
+    // An istream_iterator can only be read once
+    istringstream source("2 3 5 7 11 13");
+    BinarySearchTree<int, less<int>, bst_avl> bst(
+        (istream_iterator<int>(source)), istream_iterator<int>());
+    ASSERT_EQUAL(bst.size(), 6);
+    ASSERT_TRUE(bst.check_balance_invariant());
+    int expected[] = {2, 3, 5, 7, 11, 13};
+    ASSERT_TRUE(equal(bst.begin(), bst.end(), expected));
+
+    istringstream words("bob euchre exam");
+    BinarySearchTree<string> strings;
+    strings.assign(istream_iterator<string>(words),
+                   istream_iterator<string>());
+    ASSERT_EQUAL(strings.size(), 3);
+    ASSERT_EQUAL(*strings.max_element(), "exam");
+}
+
+TEST(test_assign_then_insert) {
+    BinarySearchTree<int, less<int>, bst_avl, bst_pool_nodes> bst;
+    bst.insert(100);
+    int sorted[] = {1, 2, 3, 5, 8, 13, 21};
+    bst.assign(sorted, sorted + 7);
+    ASSERT_EQUAL(bst.size(), 7);
+    ASSERT_TRUE(bst.find(100) == bst.end());
+    bst.insert(4);
+    ASSERT_TRUE(bst.check_balance_invariant());
+    ASSERT_EQUAL(bst.rank(5), 4);
+}
+
+TEST(test_freeze) {
+    for (int n = 0; n < 70; ++n) {
+        BinarySearchTree<int, less<int>, bst_avl> bst;
+        for (int i = 0; i < n; ++i) {
+            bst.insert(2 * i);
+        }
+        FrozenTree<int> frozen = bst.freeze();
+        ASSERT_EQUAL(frozen.size(), bst.size());
+        ASSERT_TRUE(equal(frozen.begin(), frozen.end(), bst.begin()));
+        for (int i = -1; i < 2 * n + 1; ++i) {
+            FrozenTree<int>::Iterator it = frozen.find(i);
+            if (i % 2 == 0 && i >= 0 && i < 2 * n) {
+                ASSERT_EQUAL(*it, i);
+            }
+            else {
+                ASSERT_TRUE(it == frozen.end());
+            }
+            BinarySearchTree<int, less<int>, bst_avl>::Iterator expected
+              = bst.min_greater_than(i);
+            if (expected == bst.end()) {
+                ASSERT_TRUE(frozen.min_greater_than(i) == frozen.end());
+            }
+            else {
+                ASSERT_EQUAL(*frozen.min_greater_than(i), *expected);
+            }
+        }
+        if (n > 0) {
+            ASSERT_EQUAL(*frozen.max_element(), 2 * n - 2);
+            ASSERT_EQUAL(*--frozen.max_element(), max(0, 2 * n - 4));
+        }
+    }
+}
+
+TEST(test_freeze_reverse_iteration) {
+    BinarySearchTree<string> bst;
+    for (const char *word : {"exam", "euchre", "calculator", "image", "bob"}) {
+        bst.insert(word);
+    }
+    FrozenTree<string> frozen = bst.freeze();
+    vector<string> backwards;
+    for (FrozenTree<string>::Iterator it = frozen.max_element();
+         it != frozen.end(); --it) {
+        backwards.push_back(*it);
+    }
+    ASSERT_EQUAL(backwards, vector<string>({"image", "exam", "euchre",
+                                            "calculator", "bob"}));
+    ASSERT_EQUAL(*frozen.lower_bound("d"), "euchre");
+}
+
+// Orders ints ascending or descending depending on how it was made
+struct Either_order {
+    bool descending;
+
+    Either_order(bool descending_in = false)
+      : descending(descending_in) { }
+
+    bool operator()(int a, int b) const {
+        return descending ? b < a : a < b;
+    }
+};
+
+TEST(test_freeze_keeps_comparator) {
+    BinarySearchTree<int, Either_order> bst(Either_order(true));
+    for (int i : {3, 1, 4, 5, 9, 2, 6}) {
+        bst.insert(i);
+    }
+    FrozenTree<int, Either_order> frozen = bst.freeze();
+    ASSERT_EQUAL(vector<int>(frozen.begin(), frozen.end()),
+                 vector<int>({9, 6, 5, 4, 3, 2, 1}));
+    ASSERT_EQUAL(*frozen.find(4), 4);
+    ASSERT_TRUE(frozen.find(7) == frozen.end());
+    ASSERT_EQUAL(*frozen.min_greater_than(4), 3);
+}
+
+TEST(test_freeze_input_range) {
+    istringstream iss("1 3 5 7 9");
+    FrozenTree<int> frozen((istream_iterator<int>(iss)),
+                           istream_iterator<int>());
+    ASSERT_EQUAL(frozen.size(), 5);
+    ASSERT_EQUAL(vector<int>(frozen.begin(), frozen.end()),
+                 vector<int>({1, 3, 5, 7, 9}));
+    ASSERT_EQUAL(*frozen.lower_bound(4), 5);
+}
+
+TEST(test_move) {
+    BinarySearchTree<int, less<int>, bst_avl, bst_pool_nodes> bst;
+    for (int i = 0; i < 100; ++i) {
+        bst.insert(i);
+    }
+    BinarySearchTree<int, less<int>, bst_avl, bst_pool_nodes> moved(
+        std::move(bst));
+    ASSERT_TRUE(bst.empty());
+    ASSERT_EQUAL(moved.size(), 100);
+    ASSERT_TRUE(moved.check_balance_invariant());
+
+    // The moved-from tree can be used again
+    bst.insert(5);
+    bst = std::move(moved);
+    ASSERT_EQUAL(bst.size(), 100);
+    ASSERT_TRUE(moved.empty());
+    ASSERT_EQUAL(*bst.max_element(), 99);
+}
+
+// Moving a tree does not throw, so a vector of trees moves them when it
+// grows instead of copying them
+static_assert(is_nothrow_move_constructible<BinarySearchTree<int>>::value,
+              "BinarySearchTree move constructor may throw");
+static_assert(is_nothrow_move_assignable<BinarySearchTree<int>>::value,
+              "BinarySearchTree move assignment may throw");
+static_assert(is_nothrow_move_constructible<
+                BinarySearchTree<int, less<int>, bst_avl, bst_pool_nodes>
+              >::value, "pooled BinarySearchTree move may throw");
+
+TEST(test_move_in_vector) {
+    vector<BinarySearchTree<int>> trees(1);
+    trees[0].insert(280);
+    BinarySearchTree<int>::Iterator it = trees[0].begin();
+    for (int i = 0; i < 10; ++i) {
+        trees.emplace_back();
+    }
+    // The first tree's nodes were moved, not copied
+    ASSERT_TRUE(trees[0].begin() == it);
+}
+
+TEST(test_insert_rvalue_emplace) {
+    BinarySearchTree<string> bst;
+    string word = "euchre";
+    ASSERT_EQUAL(*bst.insert(std::move(word)), "euchre");
+    ASSERT_TRUE(word.empty());
+
+    pair<BinarySearchTree<string>::Iterator, bool> result
+      = bst.emplace(3, 'a');
+    ASSERT_TRUE(result.second);
+    ASSERT_EQUAL(*result.first, "aaa");
+    result = bst.emplace("euchre");
+    ASSERT_FALSE(result.second);
+    ASSERT_EQUAL(*result.first, "euchre");
+    ASSERT_EQUAL(bst.size(), 2);
+}
+
+TEST(test_find_or_insert) {
+    BinarySearchTree<int, less<int>, bst_avl> bst;
+    for (int i = 0; i < 200; ++i) {
+        pair<BinarySearchTree<int, less<int>, bst_avl>::Iterator, bool> result
+          = bst.find_or_insert(i % 50, i % 50);
+        ASSERT_EQUAL(*result.first, i % 50);
+        ASSERT_EQUAL(result.second, i < 50);
+    }
+    ASSERT_EQUAL(bst.size(), 50);
+    ASSERT_TRUE(bst.check_sorting_invariant());
+    ASSERT_TRUE(bst.check_balance_invariant());
+    ASSERT_EQUAL(bst.height(), 6);
+}
+
+TEST(test_transparent_find) {
+    BinarySearchTree<string, transparent_less> bst;
+    for (const char *word : {"exam", "euchre", "calculator", "image"}) {
+        bst.insert(word);
+    }
+    ASSERT_EQUAL(*bst.find("exam"), "exam");
+    ASSERT_TRUE(bst.find("bob") == bst.end());
+    ASSERT_EQUAL(*bst.min_greater_than("d"), "euchre");
+    ASSERT_EQUAL(bst.rank("f"), 3);
+}
+
+TEST(test_erase) {
+    // Erase in an order that hits leaves, single children and nodes with
+    // two children, checking every invariant along the way
+    BinarySearchTree<int, less<int>, bst_avl, bst_pool_nodes> bst;
+    for (int i = 0; i < 300; ++i) {
+        bst.insert((i * 37) % 300);
+    }
+    for (int i = 0; i < 300; i += 2) {
+        ASSERT_EQUAL(bst.erase((i * 11) % 300), 1);
+        ASSERT_TRUE(bst.check_sorting_invariant());
+        ASSERT_TRUE(bst.check_balance_invariant());
+    }
+    ASSERT_EQUAL(bst.size(), 150);
+    ASSERT_EQUAL(bst.erase(0), 0);
+    ASSERT_TRUE(bst.find(1) != bst.end());
+    ASSERT_TRUE(bst.find(2) == bst.end());
+    // Freed nodes are reused
+    bst.insert(2);
+    ASSERT_EQUAL(bst.rank(3), 2);
+}
+
+TEST(test_erase_iterator) {
+    BinarySearchTree<int> bst;
+    for (int i : {5, 3, 8, 1, 4, 7, 9, 6}) {
+        bst.insert(i);
+    }
+    BinarySearchTree<int>::Iterator keep = bst.find(6);
+    BinarySearchTree<int>::Iterator it = bst.erase(bst.find(5));
+    ASSERT_EQUAL(*it, 6);
+    ASSERT_TRUE(it == keep);
+    ASSERT_TRUE(bst.check_sorting_invariant());
+    ASSERT_TRUE(bst.check_balance_invariant());
+
+    // Erase odd elements while iterating
+    it = bst.begin();
+    while (it != bst.end()) {
+        if (*it % 2) it = bst.erase(it);
+        else ++it;
+    }
+    ostringstream oss;
+    bst.traverse_inorder(oss);
+    ASSERT_EQUAL(oss.str(), "4 6 8 ");
+    while (!bst.empty()) {
+        bst.erase(bst.begin());
+    }
+    ASSERT_TRUE(bst.begin() == bst.end());
+}
+
+TEST(test_bounds_and_ranges) {
+    BinarySearchTree<int, less<int>, bst_avl> bst;
+    for (int i = 0; i < 50; ++i) {
+        bst.insert(2 * i);
+    }
+    ASSERT_EQUAL(*bst.lower_bound(10), 10);
+    ASSERT_EQUAL(*bst.lower_bound(11), 12);
+    ASSERT_EQUAL(*bst.upper_bound(10), 12);
+    ASSERT_TRUE(bst.lower_bound(99) == bst.end());
+
+    pair<BinarySearchTree<int, less<int>, bst_avl>::Iterator,
+         BinarySearchTree<int, less<int>, bst_avl>::Iterator> range
+      = bst.equal_range(20);
+    ASSERT_EQUAL(*range.first, 20);
+    ASSERT_EQUAL(*range.second, 22);
+    range = bst.equal_range(21);
+    ASSERT_TRUE(range.first == range.second);
+
+    vector<int> visited;
+    bst.visit_range(15, 25, [&visited](int i) { visited.push_back(i); });
+    ASSERT_EQUAL(visited, vector<int>({16, 18, 20, 22, 24}));
+    visited.clear();
+    bst.visit_range(30, 30, [&visited](int i) { visited.push_back(i); });
+    ASSERT_TRUE(visited.empty());
+}
+
+TEST(test_merge) {
+    BinarySearchTree<int, less<int>, bst_avl> evens;
+    BinarySearchTree<int, less<int>, bst_avl> threes;
+    for (int i = 0; i < 100; ++i) {
+        evens.insert(2 * i);
+        threes.insert(3 * i);
+    }
+    BinarySearchTree<int, less<int>, bst_avl>::Iterator kept = evens.find(42);
+    evens.merge(threes);
+    // 100 evens up to 198, plus 50 odd multiples of three up to 297 and
+    // 16 multiples of six from 204 to 294
+    ASSERT_EQUAL(evens.size(), 166);
+    ASSERT_TRUE(evens.check_sorting_invariant());
+    ASSERT_TRUE(evens.check_balance_invariant());
+    ASSERT_TRUE(evens.find(42) == kept);
+    ASSERT_TRUE(evens.find(297) != evens.end());
+    ASSERT_EQUAL(threes.size(), 100);
+
+    BinarySearchTree<int, less<int>, bst_avl> empty;
+    empty.merge(threes);
+    ASSERT_EQUAL(empty.size(), 100);
+    ASSERT_EQUAL(empty.height(), 7);
+}
+
+// An element that counts how many of it are alive, and whose copy
+// constructor throws once copies_left runs out
+struct Counted {
+    static int live;
+    static int copies_left;
+    int value;
+
+    Counted(int value_in) : value(value_in) { ++live; }
+    Counted(const Counted &other) : value(other.value) {
+        if (copies_left-- == 0) throw runtime_error("copy failed");
+        ++live;
+    }
+    ~Counted() { --live; }
+
+    bool operator<(const Counted &other) const {
+        return value < other.value;
+    }
+};
+
+int Counted::live = 0;
+int Counted::copies_left = 0;
+
+TEST(test_merge_copy_throws) {
+    Counted::copies_left = 100;
+    {
+        BinarySearchTree<Counted> mine;
+        BinarySearchTree<Counted> theirs;
+        for (int i = 0; i < 10; ++i) {
+            mine.insert(Counted(2 * i));
+            theirs.insert(Counted(2 * i + 1));
+        }
+        ASSERT_EQUAL(Counted::live, 20);
+
+        // The fourth copy throws after three nodes were created
+        Counted::copies_left = 3;
+        bool threw = false;
+        try {
+            mine.merge(theirs);
+        }
+        catch (const runtime_error &) {
+            threw = true;
+        }
+        ASSERT_TRUE(threw);
+        ASSERT_EQUAL(Counted::live, 20);
+        ASSERT_EQUAL(mine.size(), 10);
+        ASSERT_TRUE(mine.check_sorting_invariant());
+
+        Counted::copies_left = 10;
+        mine.merge(theirs);
+        ASSERT_EQUAL(mine.size(), 20);
+        ASSERT_EQUAL(Counted::live, 30);
+    }
+    ASSERT_EQUAL(Counted::live, 0);
+}
+
+TEST(test_splay) {
+    BinarySearchTree<int, less<int>, bst_splay> bst;
+    for (int i = 0; i < 100; ++i) {
+        bst.insert(i);
+        // Every insertion splays the new element to the root
+        ostringstream oss;
+        bst.traverse_preorder(oss);
+        ASSERT_EQUAL(oss.str().substr(0, oss.str().find(' ')),
+                     to_string(i));
+    }
+    // Sorted insertions leave a path, which one access roughly halves
+    ASSERT_EQUAL(bst.height(), 100);
+    ASSERT_EQUAL(*bst.find(0), 0);
+    ASSERT_EQUAL(bst.height(), 100);
+    ASSERT_EQUAL(*bst.access(0), 0);
+    ASSERT_TRUE(bst.height() <= 52);
+    ASSERT_TRUE(bst.check_sorting_invariant());
+    ASSERT_TRUE(bst.check_balance_invariant());
+
+    ostringstream oss;
+    bst.traverse_preorder(oss);
+    ASSERT_EQUAL(oss.str().substr(0, 2), "0 ");
+
+    // An element near the top is left where it is, even when the search
+    // misses
+    size_t height = bst.height();
+    ASSERT_TRUE(bst.access(1000) == bst.end());
+    ASSERT_EQUAL(*bst.access(99), 99);
+    ASSERT_EQUAL(bst.height(), height);
+    oss.str("");
+    bst.traverse_preorder(oss);
+    ASSERT_EQUAL(oss.str().substr(0, 2), "0 ");
+
+    // A missing element splays the last element the search reached, if
+    // that is deep enough
+    BinarySearchTree<int, less<int>, bst_splay> path;
+    for (int i = 0; i < 100; ++i) {
+        path.insert(i);
+    }
+    ASSERT_TRUE(path.access(-1) == path.end());
+    oss.str("");
+    path.traverse_preorder(oss);
+    ASSERT_EQUAL(oss.str().substr(0, 2), "0 ");
+
+    for (int i = 0; i < 100; i += 3) {
+        ASSERT_EQUAL(bst.erase(i), 1);
+        ASSERT_TRUE(bst.check_balance_invariant());
+    }
+    ASSERT_EQUAL(bst.size(), 66);
+    ASSERT_TRUE(bst.check_sorting_invariant());
+    ASSERT_EQUAL(bst.rank(50), 33);
+}
 
-TEST_MAIN()
\ No newline at end of file
+TEST_MAIN()
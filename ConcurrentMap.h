@@ -0,0 +1,160 @@
+#ifndef CONCURRENT_MAP_H
+#define CONCURRENT_MAP_H
+
+#include "PersistentTree.h"
+#include <functional> //less
+#include <memory>   //shared_ptr, make_shared, atomic_load, atomic_store
+#include <mutex>
+#include <utility>  //pair
+
+// OVERVIEW: A Map that any number of threads can read while other threads
+//           write it. The contents are a PersistentTree, and every change
+//           builds a new version of it and publishes that version by
+//           swapping one shared pointer, as in RCU. A reader loads the
+//           current version and then searches or iterates it without any
+//           further synchronization; the version stays valid for as long
+//           as the reader holds it, and is freed when the last reader
+//           lets go. Writers are serialized with a mutex, so they never
+//           block readers.
+template <typename Key_type, typename Value_type,
+          typename Key_compare=std::less<Key_type> // default argument
+         >
+class ConcurrentMap {
+
+private:
+  using Pair_type = std::pair<Key_type, Value_type>;
+
+  // A custom comparator. It is transparent, so a version can be searched
+  // with a bare key.
+  class PairComp {
+    private:
+      Key_compare less;
+
+    public:
+      using is_transparent = void;
+
+      bool operator()(const Pair_type &lhs, const Pair_type &rhs) const {
+        return less(lhs.first, rhs.first);
+      }
+
+      template <typename K>
+      bool operator()(const K &lhs, const Pair_type &rhs) const {
+        return less(lhs, rhs.first);
+      }
+      template <typename K>
+      bool operator()(const Pair_type &lhs, const K &rhs) const {
+        return less(lhs.first, rhs);
+      }
+  };
+
+public:
+
+  // One version of the contents. Snapshots never change, so they can be
+  // searched and iterated freely.
+  using Snapshot = PersistentTree<Pair_type, PairComp>;
+  using Iterator = typename Snapshot::Iterator;
+
+  // Constructor
+  ConcurrentMap()
+    : published(std::make_shared<const Snapshot>()) { }
+
+  // EFFECTS : Returns the current version. Safe to call from any thread.
+  Snapshot snapshot() const {
+    return *std::atomic_load(&published);
+  }
+
+  // EFFECTS : Returns the number of elements in the current version.
+  size_t size() const {
+    return std::atomic_load(&published)->size();
+  }
+
+  // MODIFIES: value
+  // EFFECTS : If the current version has an element with a key equivalent
+  //           to k, copies its mapped value into value and returns true.
+  //           Otherwise returns false. Safe to call from any thread.
+  bool find(const Key_type& k, Value_type &value) const {
+    std::shared_ptr<const Snapshot> current = std::atomic_load(&published);
+    Iterator itor = current->find(k);
+    if (itor == current->end()) return false;
+    value = itor->second;
+    return true;
+  }
+
+  // MODIFIES: this
+  // EFFECTS : Inserts val unless its key is already present. Returns
+  //           whether it was inserted.
+  bool insert(const Pair_type &val) {
+    bool inserted = false;
+    write([&](Snapshot &next) {
+      inserted = next.insert(val);
+    });
+    return inserted;
+  }
+
+  // MODIFIES: this
+  // EFFECTS : Maps k to value, replacing any existing mapped value.
+  //           Returns whether k was new.
+  bool insert_or_assign(const Key_type& k, const Value_type& value) {
+    bool inserted = false;
+    write([&](Snapshot &next) {
+      inserted = next.insert_or_assign(Pair_type(k, value));
+    });
+    return inserted;
+  }
+
+  // MODIFIES: this
+  // EFFECTS : Calls fn on a copy of the mapped value for k, which is
+  //           value-initialized if k is not present, and stores the result
+  //           under k. For example, update(word, [](int &n) { ++n; })
+  //           counts words.
+  template <typename Function>
+  void update(const Key_type& k, Function fn) {
+    write([&](Snapshot &next) {
+      Pair_type entry(k, Value_type());
+      Iterator itor = next.find(k);
+      if (itor != next.end()) entry.second = itor->second;
+      fn(entry.second);
+      next.insert_or_assign(entry);
+    });
+  }
+
+  // MODIFIES: this
+  // EFFECTS : Removes the element with a key equivalent to k, if there is
+  //           one. Returns the number of elements removed.
+  size_t erase(const Key_type& k) {
+    size_t erased = 0;
+    write([&](Snapshot &next) {
+      erased = next.erase(k);
+    });
+    return erased;
+  }
+
+  // MODIFIES: this
+  // EFFECTS : Calls fn on a copy of the current version, which it may
+  //           change freely, and then publishes the result. Readers see
+  //           either none or all of the changes fn makes, so a batch of
+  //           updates costs one publication.
+  template <typename Function>
+  void write(Function fn) {
+    std::lock_guard<std::mutex> lock(writer);
+    Snapshot next = *published;
+    fn(next);
+    std::atomic_store(&published,
+                      std::make_shared<const Snapshot>(std::move(next)));
+  }
+
+private:
+  // The current version. Only accessed through std::atomic_load and
+  // std::atomic_store, except by the writer holding the mutex, which
+  // is the only thread that stores to it.
+  std::shared_ptr<const Snapshot> published;
+
+  // Serializes writers
+  std::mutex writer;
+
+  // Disable copying; take a snapshot instead
+  ConcurrentMap(const ConcurrentMap &);
+  ConcurrentMap & operator=(const ConcurrentMap &);
+};
+
+#endif // CONCURRENT_MAP_H
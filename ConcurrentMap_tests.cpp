@@ -0,0 +1,105 @@
+//
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "ConcurrentMap.h"
+#include "unit_test_framework.h"
+
+using namespace std;
+
+TEST(test_single_thread) {
+    ConcurrentMap<string, int> counts;
+    ASSERT_EQUAL(counts.size(), 0);
+    ASSERT_TRUE(counts.insert({"exam", 1}));
+    ASSERT_FALSE(counts.insert({"exam", 2}));
+    ASSERT_FALSE(counts.insert_or_assign("exam", 3));
+    counts.update("euchre", [](int &n) { n += 5; });
+    counts.update("euchre", [](int &n) { n += 5; });
+
+    int value = 0;
+    ASSERT_TRUE(counts.find("exam", value));
+    ASSERT_EQUAL(value, 3);
+    ASSERT_TRUE(counts.find("euchre", value));
+    ASSERT_EQUAL(value, 10);
+    ASSERT_FALSE(counts.find("image", value));
+
+    ConcurrentMap<string, int>::Snapshot before = counts.snapshot();
+    ASSERT_EQUAL(counts.erase("exam"), 1);
+    ASSERT_EQUAL(counts.size(), 1);
+    ASSERT_EQUAL(before.size(), 2);
+    ASSERT_EQUAL(before.begin()->first, "euchre");
+}
+
+// A mapped value with no default constructor
+struct Score {
+    explicit Score(int points_in) : points(points_in) { }
+    int points;
+};
+
+TEST(test_erase_by_key) {
+    ConcurrentMap<string, Score> scores;
+    ASSERT_TRUE(scores.insert({"exam", Score(90)}));
+    ASSERT_TRUE(scores.insert({"euchre", Score(70)}));
+    ASSERT_EQUAL(scores.erase("image"), 0);
+    ASSERT_EQUAL(scores.erase("exam"), 1);
+    ASSERT_EQUAL(scores.size(), 1);
+    Score score(0);
+    ASSERT_FALSE(scores.find("exam", score));
+    ASSERT_TRUE(scores.find("euchre", score));
+    ASSERT_EQUAL(score.points, 70);
+}
+
+TEST(test_batch_write) {
+    ConcurrentMap<int, int> map;
+    map.write([](ConcurrentMap<int, int>::Snapshot &next) {
+        for (int i = 0; i < 100; ++i) {
+            next.insert({i, i * i});
+        }
+    });
+    ASSERT_EQUAL(map.size(), 100);
+    int value = 0;
+    ASSERT_TRUE(map.find(9, value));
+    ASSERT_EQUAL(value, 81);
+}
+
+TEST(test_readers_see_whole_batches) {
+    // The writer always moves one unit between two keys in one batch, so
+    // every version a reader sees has the same total
+    ConcurrentMap<int, int> map;
+    map.insert({0, 1000});
+    map.insert({1, 0});
+    atomic<bool> done(false);
+    atomic<int> bad(0);
+    vector<thread> readers;
+    for (int r = 0; r < 4; ++r) {
+        readers.push_back(thread([&map, &done, &bad]() {
+            while (!done) {
+                ConcurrentMap<int, int>::Snapshot snapshot = map.snapshot();
+                int total = 0;
+                for (const pair<int, int> &entry : snapshot) {
+                    total += entry.second;
+                }
+                if (total != 1000) ++bad;
+            }
+        }));
+    }
+    for (int i = 0; i < 2000; ++i) {
+        map.write([i](ConcurrentMap<int, int>::Snapshot &next) {
+            int from = i % 2;
+            int a = next.find({from, 0})->second;
+            int b = next.find({1 - from, 0})->second;
+            next.insert_or_assign({from, a - 1});
+            next.insert_or_assign({1 - from, b + 1});
+        });
+    }
+    done = true;
+    for (thread &reader : readers) {
+        reader.join();
+    }
+    ASSERT_EQUAL(bad.load(), 0);
+}
+
+TEST_MAIN()
@@ -0,0 +1,241 @@
+#ifndef FLAT_MAP_H
+#define FLAT_MAP_H
+
+#include <algorithm> //lower_bound, stable_sort, inplace_merge, unique
+#include <functional> //less
+#include <utility>  //pair, move
+#include <vector>
+
+// OVERVIEW: A Map stored in one vector of key-value pairs sorted by key.
+//           Lookups are binary searches and iteration walks contiguous
+//           memory, with no per-element allocation. Inserting one new key
+//           shifts the elements after it, so a FlatMap suits maps that are
+//           small or mostly read. To add many pairs, insert them as one
+//           batch, which sorts the batch and merges it in. Inserting or
+//           erasing invalidates every Iterator.
+template <typename Key_type, typename Value_type,
+          typename Key_compare=std::less<Key_type> // default argument
+         >
+class FlatMap {
+
+private:
+  using Pair_type = std::pair<Key_type, Value_type>;
+
+  // A custom comparator. It is transparent, so the pairs can be searched
+  // with a bare key.
+  class PairComp {
+    private:
+      Key_compare less;
+
+    public:
+      using is_transparent = void;
+
+      bool operator()(const Pair_type &lhs, const Pair_type &rhs) const {
+        return less(lhs.first, rhs.first);
+      }
+
+      template <typename K>
+      bool operator()(const K &lhs, const Pair_type &rhs) const {
+        return less(lhs, rhs.first);
+      }
+      template <typename K>
+      bool operator()(const Pair_type &lhs, const K &rhs) const {
+        return less(lhs.first, rhs);
+      }
+  };
+
+  // The pairs, sorted by key with no two keys equivalent
+  std::vector<Pair_type> entries;
+
+  // An instance of the comparator. Use this to compare keys.
+  PairComp less;
+
+public:
+
+  using Iterator = typename std::vector<Pair_type>::iterator;
+  using Const_iterator = typename std::vector<Pair_type>::const_iterator;
+
+  // Constructor
+  FlatMap() { }
+
+  // EFFECTS : Builds a FlatMap holding the pairs in [first, last), which
+  //           need not be sorted. Of pairs with equivalent keys, the first
+  //           is kept.
+  template <typename Iter>
+  FlatMap(Iter first, Iter last) {
+    insert(first, last);
+  }
+
+  // EFFECTS : Returns whether this FlatMap is empty.
+  bool empty() const {
+    return entries.empty();
+  }
+
+  // EFFECTS : Returns the number of elements in this FlatMap.
+  size_t size() const {
+    return entries.size();
+  }
+
+  // MODIFIES: this
+  // EFFECTS : Makes room for n elements without reallocating.
+  void reserve(size_t n) {
+    entries.reserve(n);
+  }
+
+  // MODIFIES: this
+  // EFFECTS : Removes every element.
+  void clear() {
+    entries.clear();
+  }
+
+  // EFFECTS : Searches this FlatMap for an element with a key equivalent
+  //           to k and returns an Iterator to it if found, otherwise
+  //           returns an end Iterator.
+  Iterator find(const Key_type& k) {
+    return entries.begin() + find_impl(k);
+  }
+  Const_iterator find(const Key_type& k) const {
+    return entries.begin() + find_impl(k);
+  }
+
+  // EFFECTS : Same as above for a key of another type. Only available if
+  //           Key_compare is transparent.
+  template <typename K, typename C = Key_compare,
+            typename = typename C::is_transparent>
+  Iterator find(const K& k) {
+    return entries.begin() + find_impl(k);
+  }
+  template <typename K, typename C = Key_compare,
+            typename = typename C::is_transparent>
+  Const_iterator find(const K& k) const {
+    return entries.begin() + find_impl(k);
+  }
+
+  // EFFECTS : Returns an Iterator to the first element whose key is not
+  //           less than k, or an end Iterator if there is none.
+  Iterator lower_bound(const Key_type& k) {
+    return std::lower_bound(entries.begin(), entries.end(), k, less);
+  }
+  Const_iterator lower_bound(const Key_type& k) const {
+    return std::lower_bound(entries.begin(), entries.end(), k, less);
+  }
+
+  // MODIFIES: this
+  // EFFECTS : Returns a reference to the mapped value for the given key,
+  //           inserting the key with a value-initialized mapped value if
+  //           it is not present.
+  Value_type& operator[](const Key_type& k) {
+    Iterator position = lower_bound(k);
+    if (position == entries.end() || less(k, *position)) {
+      position = entries.insert(position, Pair_type(k, Value_type()));
+    }
+    return position->second;
+  }
+
+  // MODIFIES: this, k
+  // EFFECTS : Same as above, but moves k into a new element.
+  Value_type& operator[](Key_type&& k) {
+    Iterator position = lower_bound(k);
+    if (position == entries.end() || less(k, *position)) {
+      position = entries.insert(position,
+                                Pair_type(std::move(k), Value_type()));
+    }
+    return position->second;
+  }
+
+  // MODIFIES: this
+  // EFFECTS : Inserts the given element unless its key is already present.
+  //           Returns an iterator to the element with that key, along with
+  //           whether the given element was inserted.
+  std::pair<Iterator, bool> insert(const Pair_type &val) {
+    Iterator position = lower_bound(val.first);
+    if (position != entries.end() && !less(val, *position)) {
+      return std::make_pair(position, false);
+    }
+    return std::make_pair(entries.insert(position, val), true);
+  }
+
+  // MODIFIES: this, val
+  // EFFECTS : Same as above, but moves val into the FlatMap.
+  std::pair<Iterator, bool> insert(Pair_type &&val) {
+    Iterator position = lower_bound(val.first);
+    if (position != entries.end() && !less(val, *position)) {
+      return std::make_pair(position, false);
+    }
+    return std::make_pair(entries.insert(position, std::move(val)), true);
+  }
+
+  // MODIFIES: this
+  // EFFECTS : Inserts the pairs in [first, last), which need not be
+  //           sorted, unless their keys are already present. Of new pairs
+  //           with equivalent keys, the first is kept. The batch is
+  //           appended, sorted and merged in, so inserting k pairs takes
+  //           O(n + k log k) time instead of O(n) per pair.
+  template <typename Iter>
+  void insert(Iter first, Iter last) {
+    size_t old_size = entries.size();
+    entries.insert(entries.end(), first, last);
+    Iterator middle = entries.begin() + old_size;
+    // Stable, so existing pairs and earlier new pairs come first among
+    // equivalent keys and survive the unique below
+    std::stable_sort(middle, entries.end(), less);
+    std::inplace_merge(entries.begin(), middle, entries.end(), less);
+    PairComp compare = less;
+    entries.erase(std::unique(entries.begin(), entries.end(),
+                              [compare](const Pair_type &lhs,
+                                        const Pair_type &rhs) {
+                                return !compare(lhs, rhs);
+                              }),
+                  entries.end());
+  }
+
+  // REQUIRES: position is a dereferenceable Iterator into this FlatMap
+  // MODIFIES: this
+  // EFFECTS : Removes the element at position and returns an Iterator to
+  //           the element after it.
+  Iterator erase(Iterator position) {
+    return entries.erase(position);
+  }
+
+  // MODIFIES: this
+  // EFFECTS : Removes the element with a key equivalent to k, if there is
+  //           one. Returns the number of elements removed.
+  size_t erase(const Key_type& k) {
+    Iterator position = find(k);
+    if (position == entries.end()) return 0;
+    entries.erase(position);
+    return 1;
+  }
+
+  // EFFECTS : Returns an iterator to the first key-value pair in this
+  //           FlatMap.
+  Iterator begin() {
+    return entries.begin();
+  }
+  Const_iterator begin() const {
+    return entries.begin();
+  }
+
+  // EFFECTS : Returns an iterator to "past-the-end".
+  Iterator end() {
+    return entries.end();
+  }
+  Const_iterator end() const {
+    return entries.end();
+  }
+
+private:
+  // EFFECTS : Returns the position of the element with a key equivalent
+  //           to k, or size() if there is none.
+  template <typename K>
+  size_t find_impl(const K& k) const {
+    typename std::vector<Pair_type>::const_iterator position
+      = std::lower_bound(entries.begin(), entries.end(), k, less);
+    if (position == entries.end() || less(k, *position)) {
+      return entries.size();
+    }
+    return static_cast<size_t>(position - entries.begin());
+  }
+};
+
+#endif // FLAT_MAP_H
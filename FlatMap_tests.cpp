@@ -0,0 +1,95 @@
+//
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "FlatMap.h"
+#include "Map.h"
+#include "unit_test_framework.h"
+
+using namespace std;
+
+TEST(test_empty) {
+    FlatMap<string, int> map;
+    ASSERT_TRUE(map.empty());
+    ASSERT_EQUAL(map.size(), 0);
+    ASSERT_TRUE(map.begin() == map.end());
+    ASSERT_TRUE(map.find("exam") == map.end());
+    ASSERT_EQUAL(map.erase("exam"), 0);
+}
+
+TEST(test_count_words) {
+    FlatMap<string, int> counts;
+    for (const char *word : {"exam", "euchre", "exam", "image", "bob",
+                             "exam", "dealer", "euchre"}) {
+        ++counts[word];
+    }
+    ASSERT_EQUAL(counts.size(), 5);
+    ASSERT_EQUAL(counts["exam"], 3);
+    ASSERT_EQUAL(counts.find("euchre")->second, 2);
+    ASSERT_TRUE(counts.find("piazza") == counts.end());
+    ASSERT_EQUAL(counts.lower_bound("c")->first, "dealer");
+
+    // Iteration is in key order over contiguous storage
+    vector<string> keys;
+    for (const pair<string, int> &entry : counts) {
+        keys.push_back(entry.first);
+    }
+    ASSERT_EQUAL(keys, vector<string>({"bob", "dealer", "euchre", "exam",
+                                       "image"}));
+    ASSERT_TRUE(&*(counts.begin() + 1) == &*counts.begin() + 1);
+
+    const FlatMap<string, int> &const_counts = counts;
+    ASSERT_EQUAL(const_counts.find("bob")->second, 1);
+    ASSERT_EQUAL(const_counts.begin()->first, "bob");
+
+    ASSERT_EQUAL(counts.erase("dealer"), 1);
+    counts.erase(counts.find("bob"));
+    ASSERT_EQUAL(counts.size(), 3);
+    ASSERT_EQUAL(counts.begin()->first, "euchre");
+}
+
+TEST(test_insert) {
+    FlatMap<string, int> map;
+    pair<FlatMap<string, int>::Iterator, bool> result
+      = map.insert({"exam", 1});
+    ASSERT_TRUE(result.second);
+    result = map.insert({"exam", 2});
+    ASSERT_FALSE(result.second);
+    ASSERT_EQUAL(result.first->second, 1);
+    pair<string, int> entry("calculator", 3);
+    ASSERT_TRUE(map.insert(entry).second);
+    ASSERT_EQUAL(map.begin()->first, "calculator");
+}
+
+TEST(test_batch_insert) {
+    FlatMap<int, string> map;
+    map[4] = "four";
+    map[10] = "ten";
+    vector<pair<int, string>> batch = {{7, "seven"}, {4, "FOUR"},
+                                       {1, "one"}, {7, "SEVEN"},
+                                       {12, "twelve"}, {1, "ONE"}};
+    map.insert(batch.begin(), batch.end());
+    ASSERT_EQUAL(map.size(), 5);
+    // Existing pairs win, and so do earlier pairs within the batch
+    ASSERT_EQUAL(map[4], "four");
+    ASSERT_EQUAL(map[7], "seven");
+    ASSERT_EQUAL(map[1], "one");
+    ASSERT_TRUE(is_sorted(map.begin(), map.end()));
+
+    FlatMap<int, string> built(batch.begin(), batch.end());
+    ASSERT_EQUAL(built.size(), 4);
+    ASSERT_EQUAL(built.begin()->second, "one");
+}
+
+TEST(test_transparent) {
+    FlatMap<string, int, transparent_less> map;
+    map["exam"] = 1;
+    ASSERT_EQUAL(map.find("exam")->second, 1);
+    const FlatMap<string, int, transparent_less> &const_map = map;
+    ASSERT_TRUE(const_map.find("image") == const_map.end());
+}
+
+TEST_MAIN()
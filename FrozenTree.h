@@ -0,0 +1,285 @@
+#ifndef FROZEN_TREE_H
+#define FROZEN_TREE_H
+
+#include <cassert>  //assert
+#include <cstddef>  //ptrdiff_t
+#include <functional> //less
+#include <iterator> //distance, iterator_traits, make_move_iterator
+#include <vector>
+
+// A read-only sorted set stored in Eytzinger order: the root at index 1,
+// and the children of index k at 2k and 2k + 1. The tree is implicit, so
+// there are no child pointers, and the top levels that every search
+// passes through share a few cache lines. Searches do no comparisons
+// that branch; they only compute the next index, and prefetch the nodes
+// four levels below the current one.
+//
+// A FrozenTree is normally made by BinarySearchTree::freeze() once a tree
+// will not be modified any more, and offers the same lookups.
+template <typename T,
+          typename Compare=std::less<T> // default if argument isn't provided
+         >
+class FrozenTree {
+public:
+
+  // EFFECTS: Builds an empty FrozenTree.
+  FrozenTree() { }
+
+  // REQUIRES: [first, last) is sorted by less_in and holds no
+  //           equivalent elements
+  // EFFECTS:  Builds a FrozenTree holding the elements of [first, last)
+  //           in O(n) time, which orders them with a copy of less_in.
+  template <typename Iter>
+  FrozenTree(Iter first, Iter last, const Compare &less_in = Compare())
+    : less(less_in) {
+    assign_impl(first, last,
+                typename std::iterator_traits<Iter>::iterator_category());
+  }
+
+  // EFFECTS: Returns whether this FrozenTree is empty.
+  bool empty() const {
+    return data.empty();
+  }
+
+  // EFFECTS: Returns the number of elements in this FrozenTree.
+  size_t size() const {
+    return data.empty() ? 0 : data.size() - 1;
+  }
+
+  class Iterator {
+    // OVERVIEW: Iterator interface for FrozenTree. Iterates over the
+    //           elements in ascending order. An Iterator is an index into
+    //           the layout, and incrementing it moves between parent and
+    //           child indices with shifts.
+
+  public:
+    // Member types so standard algorithms accept an Iterator
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T *;
+    using reference = const T &;
+
+    Iterator()
+      : tree(nullptr), index(0) { }
+
+    // EFFECTS: Returns the current element by reference.
+    const T &operator*() const {
+      return tree->data[index];
+    }
+
+    // EFFECTS: Returns the current element by pointer.
+    const T *operator->() const {
+      return &tree->data[index];
+    }
+
+    // Prefix ++
+    Iterator &operator++() {
+      size_t n = tree->size();
+      if (2 * index + 1 <= n) {
+        // Next element is the minimum of the right subtree
+        index = 2 * index + 1;
+        while (2 * index <= n) {
+          index *= 2;
+        }
+      }
+      else {
+        // Climb while arriving from a right child, then once more
+        while (index & 1) {
+          index >>= 1;
+        }
+        index >>= 1;
+      }
+      return *this;
+    }
+
+    // Postfix ++ (implemented in terms of prefix ++)
+    Iterator operator++(int) {
+      Iterator result(*this);
+      ++(*this);
+      return result;
+    }
+
+    // REQUIRES: this Iterator is not an end Iterator
+    // EFFECTS:  Moves to the previous element, or to an end Iterator if
+    //           this Iterator is at the minimum element.
+    // Prefix --
+    Iterator &operator--() {
+      size_t n = tree->size();
+      if (2 * index <= n) {
+        // Previous element is the maximum of the left subtree
+        index = 2 * index;
+        while (2 * index + 1 <= n) {
+          index = 2 * index + 1;
+        }
+      }
+      else {
+        // Climb while arriving from a left child, then once more
+        while (index > 1 && !(index & 1)) {
+          index >>= 1;
+        }
+        index >>= 1;
+      }
+      return *this;
+    }
+
+    // Postfix -- (implemented in terms of prefix --)
+    Iterator operator--(int) {
+      Iterator result(*this);
+      --(*this);
+      return result;
+    }
+
+    bool operator==(const Iterator &rhs) const {
+      return index == rhs.index;
+    }
+
+    bool operator!=(const Iterator &rhs) const {
+      return index != rhs.index;
+    }
+
+  private:
+    friend class FrozenTree;
+
+    const FrozenTree *tree;
+
+    // Position in the layout, or 0 for an end Iterator
+    size_t index;
+
+    Iterator(const FrozenTree *tree_in, size_t index_in)
+      : tree(tree_in), index(index_in) { }
+
+  }; // FrozenTree::Iterator
+  ////////////////////////////////////////
+
+  // EFFECTS: Returns an iterator to the first element in this FrozenTree.
+  Iterator begin() const {
+    return min_element();
+  }
+
+  // EFFECTS: Returns an iterator to past-the-end.
+  Iterator end() const {
+    return Iterator(this, 0);
+  }
+
+  // EFFECTS: Returns an Iterator to the minimum element in this
+  //          FrozenTree or an end Iterator if the tree is empty.
+  Iterator min_element() const {
+    size_t index = 0;
+    if (!empty()) {
+      index = 1;
+      while (2 * index <= size()) {
+        index *= 2;
+      }
+    }
+    return Iterator(this, index);
+  }
+
+  // EFFECTS: Returns an Iterator to the maximum element in this
+  //          FrozenTree or an end Iterator if the tree is empty.
+  Iterator max_element() const {
+    size_t index = 0;
+    if (!empty()) {
+      index = 1;
+      while (2 * index + 1 <= size()) {
+        index = 2 * index + 1;
+      }
+    }
+    return Iterator(this, index);
+  }
+
+  // EFFECTS: Returns an Iterator to the minimum element in this
+  //          FrozenTree not less than the given value, or an end Iterator
+  //          if there is none.
+  Iterator lower_bound(const T &value) const {
+    return Iterator(this, descend_impl(value, false));
+  }
+
+  // EFFECTS: Returns an Iterator to the minimum element in this
+  //          FrozenTree greater than the given value.
+  //          If the tree is empty, returns an end Iterator.
+  Iterator min_greater_than(const T &value) const {
+    return Iterator(this, descend_impl(value, true));
+  }
+
+  // EFFECTS: Searches this tree for an element equivalent to query.
+  //          Returns an iterator to the existing element if found,
+  //          and an end iterator otherwise.
+  Iterator find(const T &query) const {
+    size_t index = descend_impl(query, false);
+    if (index != 0 && less(query, data[index])) index = 0;
+    return Iterator(this, index);
+  }
+
+private:
+
+  // DATA REPRESENTATION
+  // The elements in Eytzinger order, starting at index 1. Empty if the
+  // tree is empty.
+  std::vector<T> data;
+
+  // An instance of the Compare type. Use this to compare elements.
+  Compare less;
+
+  // MODIFIES: this FrozenTree
+  // EFFECTS:  Fills the layout from the forward range [first, last),
+  //           which is read twice: once to count it and once to fill.
+  template <typename Iter>
+  void assign_impl(Iter first, Iter last, std::forward_iterator_tag) {
+    size_t n = static_cast<size_t>(std::distance(first, last));
+    if (n == 0) return;
+    // Slot 0 is never searched; filling with a copy of the first element
+    // avoids requiring a default constructor
+    data.assign(n + 1, *first);
+    fill_impl(first, 1);
+  }
+
+  // MODIFIES: this FrozenTree
+  // EFFECTS:  Same as above for an input range, which is moved through a
+  //           buffer since it can only be read once.
+  template <typename Iter>
+  void assign_impl(Iter first, Iter last, std::input_iterator_tag) {
+    std::vector<T> buffer(first, last);
+    assign_impl(std::make_move_iterator(buffer.begin()),
+                std::make_move_iterator(buffer.end()),
+                std::forward_iterator_tag());
+  }
+
+  // MODIFIES: first
+  // EFFECTS:  Stores the next elements of 'first' in the subtree rooted at
+  //           'index' in in-order, advancing 'first' past them.
+  template <typename Iter>
+  void fill_impl(Iter &first, size_t index) {
+    if (index >= data.size()) return;
+    fill_impl(first, 2 * index);
+    data[index] = *first;
+    ++first;
+    fill_impl(first, 2 * index + 1);
+  }
+
+  // EFFECTS: Returns the index of the first element greater than 'value'
+  //          if 'strict', or not less than 'value' otherwise, or 0 if
+  //          there is none.
+  size_t descend_impl(const T &value, bool strict) const {
+    const T *base = data.data();
+    size_t n = size();
+    size_t index = 1;
+    while (index <= n) {
+#if defined(__GNUC__)
+      if (16 * index <= n) __builtin_prefetch(base + 16 * index);
+#endif
+      // Go right past elements that are too small
+      bool right = strict ? !less(value, base[index])
+                          : less(base[index], value);
+      index = 2 * index + right;
+    }
+    // The answer is where the search last went left: drop the trailing
+    // right turns and then that left turn
+    while (index & 1) {
+      index >>= 1;
+    }
+    return index >> 1;
+  }
+};
+
+#endif // FROZEN_TREE_H
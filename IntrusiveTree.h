@@ -0,0 +1,465 @@
+#ifndef INTRUSIVE_TREE_H
+#define INTRUSIVE_TREE_H
+
+#include <cassert>  //assert
+#include <cstddef>  //ptrdiff_t
+#include <functional> //less
+#include <iterator> //bidirectional_iterator_tag
+#include <algorithm> //max
+#include <utility>  //pair
+#include "TreeLinks.h"
+
+template <typename T> class bst_hook;
+template <typename T, bst_hook<T> T::*Hook, typename Compare>
+class IntrusiveTree;
+
+// The links an object needs to be an element of one IntrusiveTree. An
+// object that should be in several trees at once has one bst_hook member
+// for each of them. A hook belongs to the object: copying the object gives
+// the copy fresh, unlinked hooks.
+template <typename T>
+class bst_hook {
+public:
+  bst_hook()
+    : left(nullptr), right(nullptr), parent(nullptr), height(0) { }
+
+  bst_hook(const bst_hook &)
+    : bst_hook() { }
+
+  bst_hook & operator=(const bst_hook &) {
+    return *this;
+  }
+
+  // EFFECTS: Returns whether the object is in a tree through this hook.
+  bool is_linked() const {
+    return height != 0;
+  }
+
+private:
+  template <typename U, bst_hook<U> U::*Hook, typename Compare>
+  friend class IntrusiveTree;
+
+  T *left;
+  T *right;
+  T *parent;
+  int height;
+};
+
+// OVERVIEW: A sorted set of objects that live elsewhere. The links are
+//           stored in the objects themselves, in the bst_hook member
+//           named by Hook, so inserting and erasing never allocate and
+//           never copy an element. The tree is AVL balanced. It does not
+//           own its elements: each must stay alive, and must not change
+//           how it compares, while it is in the tree. To reorder an
+//           element, erase it, change it and insert it again.
+//
+//           For example, with
+//             struct Entry {
+//               std::string word;
+//               int count;
+//               bst_hook<Entry> by_word;
+//               bst_hook<Entry> by_count;
+//             };
+//           the same Entry objects can be indexed by
+//             IntrusiveTree<Entry, &Entry::by_word, Word_less>
+//           and
+//             IntrusiveTree<Entry, &Entry::by_count, Count_less>
+//           at the same time.
+template <typename T,
+          bst_hook<T> T::*Hook,
+          typename Compare=std::less<T> // default if argument isn't provided
+         >
+class IntrusiveTree {
+
+public:
+
+  // Default constructor
+  IntrusiveTree()
+    : root(nullptr), count(0) { }
+
+  // Destructor. Unlinks every element; the elements themselves are
+  // left alone.
+  ~IntrusiveTree() {
+    clear();
+  }
+
+  // MODIFIES: this IntrusiveTree
+  // EFFECTS : Removes every element, in O(n) time, without destroying any.
+  void clear() {
+    clear_impl(root);
+    root = nullptr;
+    count = 0;
+  }
+
+  // EFFECTS: Returns whether this IntrusiveTree is empty.
+  bool empty() const {
+    return root == nullptr;
+  }
+
+  // EFFECTS: Returns the height of the tree.
+  size_t height() const {
+    return static_cast<size_t>(node_height(root));
+  }
+
+  // EFFECTS: Returns the number of elements in this IntrusiveTree.
+  size_t size() const {
+    return count;
+  }
+
+  class Iterator {
+    // OVERVIEW: Iterator interface for IntrusiveTree. Iterates over the
+    //           elements in ascending order. An Iterator is a pointer to
+    //           the current element, and follows the links in its hook.
+
+  public:
+    // Member types so standard algorithms accept an Iterator
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T *;
+    using reference = T &;
+
+    Iterator()
+      : current(nullptr) { }
+
+    // EFFECTS: Returns the current element by reference. Changes to the
+    //          element must not change how it compares.
+    T &operator*() const {
+      return *current;
+    }
+
+    // EFFECTS: Returns the current element by pointer.
+    T *operator->() const {
+      return current;
+    }
+
+    // Prefix ++
+    Iterator &operator++() {
+      if (hook(current).right) {
+        current = min_element_impl(hook(current).right);
+      }
+      else {
+        // Climb until we arrive from a left child
+        T *child = current;
+        current = hook(current).parent;
+        while (current && child == hook(current).right) {
+          child = current;
+          current = hook(current).parent;
+        }
+      }
+      return *this;
+    }
+
+    // Postfix ++ (implemented in terms of prefix ++)
+    Iterator operator++(int) {
+      Iterator result(*this);
+      ++(*this);
+      return result;
+    }
+
+    // REQUIRES: this Iterator is not an end Iterator
+    // Prefix --
+    Iterator &operator--() {
+      if (hook(current).left) {
+        current = max_element_impl(hook(current).left);
+      }
+      else {
+        // Climb until we arrive from a right child
+        T *child = current;
+        current = hook(current).parent;
+        while (current && child == hook(current).left) {
+          child = current;
+          current = hook(current).parent;
+        }
+      }
+      return *this;
+    }
+
+    // Postfix -- (implemented in terms of prefix --)
+    Iterator operator--(int) {
+      Iterator result(*this);
+      --(*this);
+      return result;
+    }
+
+    bool operator==(const Iterator &rhs) const {
+      return current == rhs.current;
+    }
+
+    bool operator!=(const Iterator &rhs) const {
+      return current != rhs.current;
+    }
+
+  private:
+    friend class IntrusiveTree;
+
+    T *current;
+
+    explicit Iterator(T *current_in)
+      : current(current_in) { }
+
+  }; // IntrusiveTree::Iterator
+  ////////////////////////////////////////
+
+  // EFFECTS : Returns an iterator to the first element
+  //           in this IntrusiveTree.
+  Iterator begin() const {
+    return Iterator(min_element_impl(root));
+  }
+
+  // EFFECTS: Returns an iterator to past-the-end.
+  Iterator end() const {
+    return Iterator();
+  }
+
+  // EFFECTS: Returns an Iterator to the minimum element in this
+  //          IntrusiveTree or an end Iterator if the tree is empty.
+  Iterator min_element() const {
+    return begin();
+  }
+
+  // EFFECTS: Returns an Iterator to the maximum element in this
+  //          IntrusiveTree or an end Iterator if the tree is empty.
+  Iterator max_element() const {
+    return Iterator(max_element_impl(root));
+  }
+
+  // EFFECTS: Returns an Iterator to the given element, which must be in
+  //          this tree, in O(1) time.
+  Iterator iterator_to(T &item) const {
+    assert(hook(&item).is_linked());
+    return Iterator(&item);
+  }
+
+  // EFFECTS: Searches this tree for an element equivalent to query.
+  //          Returns an iterator to the existing element if found,
+  //          and an end iterator otherwise.
+  Iterator find(const T &query) const {
+    return Iterator(find_impl(query));
+  }
+
+  // EFFECTS: Same as above for a query of another type. Only available
+  //          if Compare is transparent.
+  template <typename Query, typename C = Compare,
+            typename = typename C::is_transparent>
+  Iterator find(const Query &query) const {
+    return Iterator(find_impl(query));
+  }
+
+  // EFFECTS: Returns an Iterator to the first element that is not less
+  //          than value, or an end Iterator if there is none.
+  Iterator lower_bound(const T &value) const {
+    T *result = nullptr;
+    for (T *node = root; node; ) {
+      if (less(*node, value)) {
+        node = hook(node).right;
+      }
+      else {
+        result = node;
+        node = hook(node).left;
+      }
+    }
+    return Iterator(result);
+  }
+
+  // REQUIRES: item is not in a tree through this hook
+  // MODIFIES: this IntrusiveTree, item
+  // EFFECTS : Links item into this tree unless an equivalent element is
+  //           already present. Returns an Iterator to the element
+  //           equivalent to item and whether item was linked.
+  std::pair<Iterator, bool> insert(T &item) {
+    assert(!hook(&item).is_linked());
+    T *parent = nullptr;
+    bool is_left = false;
+    for (T *node = root; node; ) {
+      parent = node;
+      if (less(item, *node)) {
+        node = hook(node).left;
+        is_left = true;
+      }
+      else if (less(*node, item)) {
+        node = hook(node).right;
+        is_left = false;
+      }
+      else {
+        return std::make_pair(Iterator(node), false);
+      }
+    }
+    bst_hook<T> &links = hook(&item);
+    links.left = links.right = nullptr;
+    links.parent = parent;
+    links.height = 1;
+    if (parent == nullptr) root = &item;
+    else if (is_left) hook(parent).left = &item;
+    else hook(parent).right = &item;
+    ++count;
+    retrace_impl(parent);
+    return std::make_pair(Iterator(&item), true);
+  }
+
+  // REQUIRES: item is in this tree
+  // MODIFIES: this IntrusiveTree, item
+  // EFFECTS : Unlinks item, rebalancing, and returns an Iterator to the
+  //           element after it. Iterators to other elements stay valid.
+  Iterator erase(T &item) {
+    assert(hook(&item).is_linked());
+    Iterator next(&item);
+    ++next;
+    detach_impl(&item);
+    --count;
+    return next;
+  }
+
+  // REQUIRES: position is a dereferenceable Iterator into this tree
+  // MODIFIES: this IntrusiveTree
+  // EFFECTS : Same as above for the element at position.
+  Iterator erase(Iterator position) {
+    return erase(*position);
+  }
+
+  // EFFECTS: Returns whether the elements are sorted, whether every hook
+  //          stores the correct parent and height, and whether the
+  //          heights of the two subtrees of every node differ by at most
+  //          one.
+  bool check_invariants() const {
+    size_t seen = 0;
+    return (root == nullptr || hook(root).parent == nullptr)
+      && check_invariants_impl(root, nullptr, nullptr, seen)
+      && seen == count;
+  }
+
+private:
+
+  // DATA REPRESENTATION
+  // The root element, or null if the tree is empty. Every other element
+  // is reached through the hooks.
+  T *root;
+
+  // The number of elements, since hooks do not store subtree sizes
+  size_t count;
+
+  // An instance of the Compare type. Use this to compare elements.
+  Compare less;
+
+  // Disable copying: an object can only be in one tree through a given
+  // hook
+  IntrusiveTree(const IntrusiveTree &);
+  IntrusiveTree & operator=(const IntrusiveTree &);
+
+  // EFFECTS : Returns the hook of 'node' that this tree uses.
+  static bst_hook<T> & hook(T *node) {
+    return node->*Hook;
+  }
+  static const bst_hook<T> & hook(const T *node) {
+    return node->*Hook;
+  }
+
+  // How tree_links reaches the links in the hooks, so that relinking and
+  // rebalancing are shared with BinarySearchTree
+  struct Hook_link_access {
+    using Node = T;
+    static T *& left(T *node) { return hook(node).left; }
+    static T *& right(T *node) { return hook(node).right; }
+    static T *& parent(T *node) { return hook(node).parent; }
+    static int height(const T *node) { return node_height(node); }
+    static void update(T *node) { update_impl(node); }
+  };
+  using Hook_links = tree_links<Hook_link_access>;
+
+  // EFFECTS : Returns the stored height of the tree rooted at 'node',
+  //           which is 0 for an empty tree.
+  static int node_height(const T *node) {
+    return node ? hook(node).height : 0;
+  }
+
+  // MODIFIES: node
+  // EFFECTS : Recomputes the height of 'node' from its children.
+  static void update_impl(T *node) {
+    hook(node).height = std::max(node_height(hook(node).left),
+                                 node_height(hook(node).right)) + 1;
+  }
+
+  // MODIFIES: the hooks of the tree rooted at 'node'
+  // EFFECTS : Resets every hook in the tree rooted at 'node'.
+  // NOTE:    This function must be tree recursive.
+  static void clear_impl(T *node) {
+    if (node == nullptr) return;
+    clear_impl(hook(node).left);
+    clear_impl(hook(node).right);
+    hook(node).left = hook(node).right = hook(node).parent = nullptr;
+    hook(node).height = 0;
+  }
+
+  // EFFECTS : Implements find for any type of query.
+  template <typename Query>
+  T * find_impl(const Query &query) const {
+    T *node = root;
+    while (node) {
+      if (less(query, *node)) node = hook(node).left;
+      else if (less(*node, query)) node = hook(node).right;
+      else return node;
+    }
+    return nullptr;
+  }
+
+  // MODIFIES: this IntrusiveTree, node
+  // EFFECTS : Unlinks 'node', which must be in this tree. A node with two
+  //           children is replaced by its successor, so no other element
+  //           moves, and then the tree is retraced from the lowest node
+  //           whose subtree changed.
+  void detach_impl(T *node) {
+    T *start = Hook_links::unlink(root, node);
+    bst_hook<T> &links = hook(node);
+    links.left = links.right = links.parent = nullptr;
+    links.height = 0;
+    retrace_impl(start);
+  }
+
+  // MODIFIES: this IntrusiveTree
+  // EFFECTS : Walks from 'node' up to the root, updating the height of
+  //           each node on the way and restoring the AVL invariant.
+  void retrace_impl(T *node) {
+    Hook_links::retrace(root, node, Hook_links::rebalance_avl);
+  }
+
+  // EFFECTS : Returns the minimum element in the tree rooted at 'node' or
+  //           a null pointer if the tree is empty.
+  static T * min_element_impl(T *node) {
+    if (node == nullptr) return node;
+    while (hook(node).left) node = hook(node).left;
+    return node;
+  }
+
+  // EFFECTS : Returns the maximum element in the tree rooted at 'node' or
+  //           a null pointer if the tree is empty.
+  static T * max_element_impl(T *node) {
+    if (node == nullptr) return node;
+    while (hook(node).right) node = hook(node).right;
+    return node;
+  }
+
+  // MODIFIES: seen
+  // EFFECTS : Returns whether the tree rooted at 'node' is a sorted AVL
+  //           tree with correct heights and parents whose elements lie
+  //           strictly between *lower and *upper (a null bound is
+  //           unbounded), and adds its number of elements to seen.
+  // NOTE:    This function must be tree recursive.
+  bool check_invariants_impl(const T *node, const T *lower, const T *upper,
+                             size_t &seen) const {
+    if (node == nullptr) return true;
+    ++seen;
+    const bst_hook<T> &links = hook(node);
+    if (lower && !less(*lower, *node)) return false;
+    if (upper && !less(*node, *upper)) return false;
+    if (links.left && hook(links.left).parent != node) return false;
+    if (links.right && hook(links.right).parent != node) return false;
+    int left = node_height(links.left);
+    int right = node_height(links.right);
+    if (links.height != std::max(left, right) + 1) return false;
+    if (left - right > 1 || right - left > 1) return false;
+    return check_invariants_impl(links.left, lower, node, seen)
+      && check_invariants_impl(links.right, node, upper, seen);
+  }
+}; // END of IntrusiveTree class
+
+#endif // INTRUSIVE_TREE_H
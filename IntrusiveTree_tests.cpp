@@ -0,0 +1,137 @@
+//
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include "IntrusiveTree.h"
+#include "unit_test_framework.h"
+
+using namespace std;
+
+struct Item {
+    int value;
+    bst_hook<Item> hook;
+
+    bool operator<(const Item &other) const {
+        return value < other.value;
+    }
+};
+
+using Item_tree = IntrusiveTree<Item, &Item::hook>;
+
+TEST(test_empty) {
+    Item_tree tree;
+    ASSERT_TRUE(tree.empty());
+    ASSERT_EQUAL(tree.size(), 0);
+    ASSERT_EQUAL(tree.height(), 0);
+    ASSERT_TRUE(tree.begin() == tree.end());
+    ASSERT_TRUE(tree.find(Item{3, {}}) == tree.end());
+    ASSERT_TRUE(tree.check_invariants());
+}
+
+TEST(test_insert_erase_random) {
+    vector<Item> items(500);
+    for (size_t i = 0; i < items.size(); ++i) {
+        items[i].value = int(i);
+    }
+    srand(280);
+    random_shuffle(items.begin(), items.end(),
+                   [](int n) { return rand() % n; });
+
+    Item_tree tree;
+    for (Item &item : items) {
+        pair<Item_tree::Iterator, bool> result = tree.insert(item);
+        ASSERT_TRUE(result.second);
+        ASSERT_TRUE(&*result.first == &item);
+        ASSERT_TRUE(item.hook.is_linked());
+    }
+    ASSERT_EQUAL(tree.size(), 500);
+    ASSERT_TRUE(tree.check_invariants());
+    ASSERT_TRUE(tree.height() <= 12);
+
+    // An equivalent object is not linked
+    Item duplicate = {250, {}};
+    ASSERT_FALSE(tree.insert(duplicate).second);
+    ASSERT_FALSE(duplicate.hook.is_linked());
+
+    int expected = 0;
+    for (const Item &item : tree) {
+        ASSERT_EQUAL(item.value, expected++);
+    }
+    ASSERT_EQUAL((--tree.max_element())->value, 498);
+    ASSERT_EQUAL(tree.max_element()->value, 499);
+    ASSERT_EQUAL(tree.lower_bound(Item{250, {}})->value, 250);
+
+    for (Item &item : items) {
+        if (item.value % 3 == 0) {
+            tree.erase(item);
+            ASSERT_FALSE(item.hook.is_linked());
+        }
+    }
+    ASSERT_EQUAL(tree.size(), 333);
+    ASSERT_TRUE(tree.check_invariants());
+    ASSERT_TRUE(tree.find(Item{300, {}}) == tree.end());
+    ASSERT_EQUAL(tree.find(Item{301, {}})->value, 301);
+
+    tree.clear();
+    ASSERT_TRUE(tree.empty());
+    for (const Item &item : items) {
+        ASSERT_FALSE(item.hook.is_linked());
+    }
+}
+
+// A vocabulary entry indexed by word and by count at the same time
+struct Entry {
+    string word;
+    int count;
+    bst_hook<Entry> by_word;
+    bst_hook<Entry> by_count;
+};
+
+struct Word_less {
+    bool operator()(const Entry &lhs, const Entry &rhs) const {
+        return lhs.word < rhs.word;
+    }
+};
+
+// Most frequent first, ties broken by word
+struct Count_less {
+    bool operator()(const Entry &lhs, const Entry &rhs) const {
+        if (lhs.count != rhs.count) return lhs.count > rhs.count;
+        return lhs.word < rhs.word;
+    }
+};
+
+TEST(test_two_indexes) {
+    vector<Entry> entries = {{"exam", 5, {}, {}}, {"euchre", 2, {}, {}},
+                             {"image", 7, {}, {}}, {"bob", 2, {}, {}}};
+    IntrusiveTree<Entry, &Entry::by_word, Word_less> words;
+    IntrusiveTree<Entry, &Entry::by_count, Count_less> counts;
+    for (Entry &entry : entries) {
+        words.insert(entry);
+        counts.insert(entry);
+    }
+    ASSERT_EQUAL(words.begin()->word, "bob");
+    ASSERT_EQUAL(counts.begin()->word, "image");
+    ASSERT_EQUAL(counts.max_element()->word, "euchre");
+
+    // Changing a count moves the entry in the count index only
+    Entry &euchre = *words.find(Entry{"euchre", 0, {}, {}});
+    counts.erase(euchre);
+    euchre.count = 10;
+    counts.insert(euchre);
+    ASSERT_TRUE(counts.check_invariants());
+    ASSERT_TRUE(words.check_invariants());
+    ASSERT_TRUE(&*counts.begin() == &euchre);
+    ASSERT_TRUE(&*counts.iterator_to(euchre) == &euchre);
+    ASSERT_EQUAL(words.find(Entry{"euchre", 0, {}, {}})->count, 10);
+
+    // A copy of an entry is in neither index
+    Entry copy = euchre;
+    ASSERT_FALSE(copy.by_word.is_linked());
+    ASSERT_TRUE(euchre.by_word.is_linked());
+}
+
+TEST_MAIN()
@@ -5,72 +5,169 @@ using namespace std;
 
 #include "BinarySearchTree.h"
 #include <cassert>  //assert
-#include <utility>  //pair
+#include <utility>  //pair, move, forward, piecewise_construct
+#include <tuple>    //forward_as_tuple
 
 template <typename Key_type, typename Value_type,
-          typename Key_compare=std::less<Key_type> // default argument
+          typename Key_compare=std::less<Key_type>, // default argument
+          typename Balance=bst_avl,
+          typename Nodes=bst_pool_nodes
          >
 class Map {
 
 private:
   using Pair_type = std::pair<Key_type, Value_type>;
 
-  // A custom comparator
+  // A custom comparator. It is transparent, so the tree can be searched
+  // with a bare key, which is compared with the keys of the elements
+  // without building a pair.
   class PairComp {
     private:
       Key_compare less;
 
     public:
-      const bool operator()(Pair_type lhs, Pair_type rhs) {
+      using is_transparent = void;
+
+      bool operator()(const Pair_type &lhs, const Pair_type &rhs) const {
         return less(lhs.first, rhs.first);
       }
+
+      template <typename K>
+      bool operator()(const K &lhs, const Pair_type &rhs) const {
+        return less(lhs, rhs.first);
+      }
+      template <typename K>
+      bool operator()(const Pair_type &lhs, const K &rhs) const {
+        return less(lhs.first, rhs);
+      }
   };
 
 private:
-  BinarySearchTree<Pair_type, PairComp> *bst;
+  using Tree_type = BinarySearchTree<Pair_type, PairComp, Balance, Nodes>;
+  Tree_type bst;
 
 public:
 
   // OVERVIEW: Maps are associative containers that store elements
   // formed by a combination of a key value and a mapped value,
   // following a specific order.
-  using Iterator = typename BinarySearchTree<Pair_type, PairComp>::Iterator;
+  using Iterator = typename Tree_type::Iterator;
   // Constructor
-  Map() {
-    bst = new BinarySearchTree<Pair_type, PairComp>;
-  }
+  Map() { }
+
+  // REQUIRES: [first, last) holds key-value pairs sorted by key with no
+  //           two keys equivalent
+  // EFFECTS : Builds a Map holding those pairs in O(n) time.
+  template <typename Iter>
+  Map(Iter first, Iter last)
+    : bst(first, last) { }
+
+  // Copying a Map copies every element. Moving one takes over its tree in
+  // constant time and leaves it empty, so a Map of Maps moves inner Maps
+  // without copying them.
+  Map(const Map &other) = default;
+  Map(Map &&other) = default;
+  Map &operator=(const Map &rhs) = default;
+  Map &operator=(Map &&rhs) = default;
 
-  // Destructor
-  ~Map() {
-    delete bst;
+  // REQUIRES: [first, last) holds key-value pairs sorted by key with no
+  //           two keys equivalent
+  // MODIFIES: this
+  // EFFECTS : Replaces the contents with those pairs in O(n) time.
+  template <typename Iter>
+  void assign(Iter first, Iter last) {
+    bst.assign(first, last);
   }
 
   // EFFECTS : Returns whether this Map is empty.
   bool empty() const {
-    return bst->empty();
+    return bst.empty();
   }
 
   // EFFECTS : Returns the number of elements in this Map.
   // NOTE : size_t is an integral type from the STL
   size_t size() const {
-    return bst->size();
+    return bst.size();
+  }
+
+  // EFFECTS : Returns the height of the underlying tree.
+  size_t height() const {
+    return bst.height();
   }
 
   // EFFECTS : Searches this Map for an element with a key equivalent
   //           to k and returns an Iterator to the associated value if found,
   //           otherwise returns an end Iterator.
   Iterator find(const Key_type& k) const {
-    Pair_type temp_pair;
-    temp_pair.first = k;
-    temp_pair.second = Value_type();
-    Iterator itor = bst->find(temp_pair);
-    if (itor == this->end()) {
-      return this->end();
-    }
-    else {
-      return itor;
-    }
-    return itor;
+    return bst.find(k);
+  }
+
+  // EFFECTS : Same as above for a key of another type, such as a
+  //           const char * for std::string keys, which is compared with
+  //           the keys directly. Only available if Key_compare is
+  //           transparent, like transparent_less.
+  template <typename K, typename C = Key_compare,
+            typename = typename C::is_transparent>
+  Iterator find(const K& k) const {
+    return bst.find(k);
+  }
+
+  // MODIFIES: this
+  // EFFECTS : Same as find, but as a use of the element found. With
+  //           bst_splay as the Balance policy, moves that element to the
+  //           root of the tree if it is found deep in the tree, so that
+  //           frequently used keys are found quickly; operator[] and
+  //           insert do this too. With the other policies, this is the
+  //           same as find.
+  Iterator access(const Key_type& k) {
+    return bst.access(k);
+  }
+
+  // EFFECTS : Same as above for a key of another type. Only available if
+  //           Key_compare is transparent.
+  template <typename K, typename C = Key_compare,
+            typename = typename C::is_transparent>
+  Iterator access(const K& k) {
+    return bst.access(k);
+  }
+
+  // EFFECTS : Returns an Iterator to the first element whose key is not
+  //           less than k, or an end Iterator if there is none.
+  Iterator lower_bound(const Key_type& k) const {
+    return bst.lower_bound(k);
+  }
+
+  // EFFECTS : Returns an Iterator to the first element whose key is
+  //           greater than k, or an end Iterator if there is none.
+  Iterator upper_bound(const Key_type& k) const {
+    return bst.upper_bound(k);
+  }
+
+  // EFFECTS : Returns the range of elements with a key equivalent to k,
+  //           which is empty or holds one element.
+  std::pair<Iterator, Iterator> equal_range(const Key_type& k) const {
+    return bst.equal_range(k);
+  }
+
+  // EFFECTS : Calls fn on every key-value pair whose key is at least lower
+  //           and less than upper, in order, visiting only those elements
+  //           and the paths down to them.
+  template <typename Function>
+  void visit_range(const Key_type& lower, const Key_type& upper,
+                   Function fn) const {
+    bst.visit_range(lower, upper, fn);
+  }
+
+  // EFFECTS : Returns the number of keys in this Map that are less than k.
+  size_t rank(const Key_type& k) const {
+    return bst.rank(k);
+  }
+
+  // EFFECTS : Returns an Iterator to the element whose key is at position
+  //           n (counting from 0) in sorted order, or an end Iterator if
+  //           n is not less than size().
+  Iterator select(size_t n) const {
+    return bst.select(n);
   }
 
   // MODIFIES: this
@@ -84,22 +181,15 @@ public:
   //           Note: value-initialization for numeric types guarantees the
   //           value will be 0 (rather than memory junk).
   Value_type& operator[](const Key_type& k) {
-    Iterator itor = this->find(k);
-    Pair_type temp_pair;
-    temp_pair.first = k;
-    temp_pair.second = Value_type();
-    if (itor != this->end()) {
-      Pair_type &pair_two = *itor;
-      return pair_two.second;
-    }
-    else {
-      std::pair<Iterator, bool> test;
-      test = insert(temp_pair);
-      itor = test.first;
-      Pair_type &test_two = *itor;
-      return test_two.second;
-    }
+    return try_emplace(k).first->second;
+  }
+
+  // MODIFIES: this, k
+  // EFFECTS : Same as above, but moves k into the Map if it is inserted.
+  Value_type& operator[](Key_type&& k) {
+    return try_emplace(std::move(k)).first->second;
   }
+
   // MODIFIES: this
   // EFFECTS : Inserts the given element into this Map if the given key
   //           is not already contained in the Map. If the key is
@@ -109,30 +199,88 @@ public:
   //           an iterator to the newly inserted element, along with
   //           the value true.
   std::pair<Iterator, bool> insert(const Pair_type &val) {
-    Iterator itor = this->find(val.first);
-    if (itor == this->end()) {
-      Iterator i = bst->insert(val);
-      std::pair<Iterator, bool> return_pair_true;
-      return_pair_true.first = i;
-      return_pair_true.second = true;
-      return return_pair_true;
-    }
-    else {
-      std::pair<Iterator, bool> return_pair_false;
-      return_pair_false.first = itor;
-      return_pair_false.second = false;
-      return return_pair_false;
-    }
+    return bst.find_or_insert(val.first, val);
+  }
+
+  // MODIFIES: this, val
+  // EFFECTS : Same as above, but moves val into the Map if it is inserted.
+  std::pair<Iterator, bool> insert(Pair_type &&val) {
+    return bst.find_or_insert(val.first, std::move(val));
+  }
+
+  // MODIFIES: this
+  // EFFECTS : Constructs a key-value pair from args in place and inserts
+  //           it if its key is not already contained in the Map. Returns
+  //           the same as insert.
+  template <typename... Args>
+  std::pair<Iterator, bool> emplace(Args&&... args) {
+    return bst.emplace(std::forward<Args>(args)...);
+  }
+
+  // MODIFIES: this
+  // EFFECTS : If k is not already contained in the Map, inserts k with a
+  //           mapped value constructed from args. Unlike emplace, nothing
+  //           is constructed if k is present. Returns the same as insert.
+  template <typename... Args>
+  std::pair<Iterator, bool> try_emplace(const Key_type& k, Args&&... args) {
+    return bst.find_or_insert(
+      k, std::piecewise_construct, std::forward_as_tuple(k),
+      std::forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  // MODIFIES: this, k
+  // EFFECTS : Same as above, but moves k into the Map if it is inserted.
+  template <typename... Args>
+  std::pair<Iterator, bool> try_emplace(Key_type&& k, Args&&... args) {
+    return bst.find_or_insert(
+      k, std::piecewise_construct, std::forward_as_tuple(std::move(k)),
+      std::forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  // REQUIRES: position is a dereferenceable Iterator into this Map
+  // MODIFIES: this
+  // EFFECTS : Removes the element at position and returns an Iterator to
+  //           the element after it.
+  Iterator erase(Iterator position) {
+    return bst.erase(position);
+  }
+
+  // MODIFIES: this
+  // EFFECTS : Removes the element with a key equivalent to k, if there is
+  //           one. Returns the number of elements removed.
+  size_t erase(const Key_type& k) {
+    return bst.erase(k);
+  }
+
+  // MODIFIES: this
+  // EFFECTS : Adds a copy of every element of other whose key is not in
+  //           this Map, and calls combine(mine, theirs) on the two mapped
+  //           values for every key in both, for example to add up counts.
+  //           Runs in O(n + m) time.
+  template <typename Combine>
+  void merge(const Map &other, Combine combine) {
+    bst.merge(other.bst,
+              [&combine](Pair_type &mine, const Pair_type &theirs) {
+                combine(mine.second, theirs.second);
+              });
+  }
+
+  // MODIFIES: this
+  // EFFECTS : Adds a copy of every element of other whose key is not in
+  //           this Map, keeping the existing mapped value for keys in
+  //           both.
+  void merge(const Map &other) {
+    bst.merge(other.bst);
   }
 
   // EFFECTS : Returns an iterator to the first key-value pair in this Map.
   Iterator begin() const {
-    return bst->begin();
+    return bst.begin();
   }
 
   // EFFECTS : Returns an iterator to "past-the-end".
   Iterator end() const {
-    return bst->end();
+    return bst.end();
   }
 };
 
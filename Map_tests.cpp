@@ -0,0 +1,229 @@
+//
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <type_traits>
+
+#include "Map.h"
+#include "unit_test_framework.h"
+
+using namespace std;
+
+// A key that counts how many times keys are copied
+struct Counted_key {
+    static int copies;
+
+    int value;
+
+    Counted_key(int value_in) : value(value_in) { }
+    Counted_key(const Counted_key &other) : value(other.value) { ++copies; }
+    Counted_key &operator=(const Counted_key &other) {
+        value = other.value;
+        ++copies;
+        return *this;
+    }
+};
+
+int Counted_key::copies = 0;
+
+bool operator<(const Counted_key &lhs, const Counted_key &rhs) {
+    return lhs.value < rhs.value;
+}
+
+TEST(test_size_sorted_keys) {
+    Map<int, int> map;
+    for (int i = 0; i < 1000; ++i) {
+        map[i] = i * i;
+    }
+    ASSERT_EQUAL(map.size(), 1000);
+    ASSERT_EQUAL(map.find(999)->second, 998001);
+}
+
+TEST(test_rank_select) {
+    Map<string, int> counts;
+    counts["exam"] = 7;
+    counts["euchre"] = 3;
+    counts["calculator"] = 5;
+    counts["image"] = 1;
+    ASSERT_EQUAL(counts.rank("calculator"), 0);
+    ASSERT_EQUAL(counts.rank("exam"), 2);
+    ASSERT_EQUAL(counts.rank("zebra"), 4);
+    ASSERT_EQUAL(counts.select(1)->first, "euchre");
+    ASSERT_EQUAL(counts.select(3)->second, 1);
+    ASSERT_EQUAL(counts.select(4), counts.end());
+}
+
+TEST(test_build_sorted_pairs) {
+    vector<pair<string, int>> sorted = {
+        {"calculator", 5}, {"euchre", 3}, {"exam", 7}, {"image", 1}
+    };
+    Map<string, int> counts(sorted.begin(), sorted.end());
+    ASSERT_EQUAL(counts.size(), 4);
+    ASSERT_EQUAL(counts["exam"], 7);
+    ASSERT_EQUAL(counts.begin()->first, "calculator");
+
+    counts.assign(sorted.begin() + 2, sorted.end());
+    ASSERT_EQUAL(counts.size(), 2);
+    ASSERT_TRUE(counts.find("euchre") == counts.end());
+}
+
+TEST(test_copy_is_deep) {
+    Map<string, int> counts;
+    counts["exam"] = 1;
+    {
+        Map<string, int> copy(counts);
+        copy["exam"] = 2;
+        copy["euchre"] = 3;
+        ASSERT_EQUAL(counts["exam"], 1);
+        ASSERT_EQUAL(counts.size(), 1);
+        counts = copy;
+    }
+    ASSERT_EQUAL(counts["exam"], 2);
+    ASSERT_EQUAL(counts.size(), 2);
+}
+
+TEST(test_move_nested) {
+    Map<string, Map<string, double>> word_label;
+    word_label["exam"]["calculator"] = 0.5;
+
+    Map<string, double> inner;
+    inner["euchre"] = 1.5;
+    Map<string, double>::Iterator it = inner.find("euchre");
+    word_label.insert({"dealer", std::move(inner)});
+    // The inner Map's nodes were moved, not copied
+    ASSERT_TRUE(word_label["dealer"].find("euchre") == it);
+    ASSERT_TRUE(inner.empty());
+
+    Map<string, Map<string, double>> moved(std::move(word_label));
+    ASSERT_TRUE(word_label.empty());
+    ASSERT_EQUAL(moved["exam"]["calculator"], 0.5);
+}
+
+static_assert(is_nothrow_move_constructible<Map<string, int>>::value,
+              "Map move constructor may throw");
+static_assert(is_nothrow_move_assignable<Map<string, int>>::value,
+              "Map move assignment may throw");
+
+TEST(test_emplace_try_emplace) {
+    Map<string, string> tags;
+    ASSERT_TRUE(tags.emplace("exam", "when").second);
+    ASSERT_FALSE(tags.emplace("exam", "where").second);
+    ASSERT_EQUAL(tags["exam"], "when");
+
+    pair<Map<string, string>::Iterator, bool> result
+      = tags.try_emplace("euchre", 3, 'x');
+    ASSERT_TRUE(result.second);
+    ASSERT_EQUAL(result.first->second, "xxx");
+    result = tags.try_emplace("euchre", 5, 'y');
+    ASSERT_FALSE(result.second);
+    ASSERT_EQUAL(result.first->second, "xxx");
+
+    string key = "image";
+    tags[std::move(key)] = "png";
+    ASSERT_EQUAL(tags.find("image")->second, "png");
+}
+
+TEST(test_count_words) {
+    Map<string, int> counts;
+    istringstream words("the dealer is bob and the exam is when the "
+                        "dealer says");
+    string word;
+    while (words >> word) {
+        ++counts[word];
+    }
+    ASSERT_EQUAL(counts.size(), 8);
+    ASSERT_EQUAL(counts["the"], 3);
+    ASSERT_EQUAL(counts["is"], 2);
+    ASSERT_EQUAL(counts["says"], 1);
+
+    pair<string, int> entry("bob", 10);
+    ASSERT_FALSE(counts.insert(std::move(entry)).second);
+    ASSERT_EQUAL(counts["bob"], 1);
+}
+
+TEST(test_find_does_not_copy) {
+    Map<Counted_key, int> map;
+    for (int i = 0; i < 100; ++i) {
+        map[i] = i;
+    }
+    Counted_key key(42);
+    int copies = Counted_key::copies;
+    ASSERT_EQUAL(map.find(key)->second, 42);
+    ASSERT_EQUAL(map.rank(key), 42);
+    ++map[key];
+    ASSERT_EQUAL(Counted_key::copies, copies);
+}
+
+TEST(test_transparent_find) {
+    Map<string, int, transparent_less> counts;
+    counts["exam"] = 3;
+    counts["euchre"] = 5;
+    const char *word = "euchre";
+    ASSERT_EQUAL(counts.find(word)->second, 5);
+    ASSERT_EQUAL(counts.find("exam")->second, 3);
+    ASSERT_TRUE(counts.find("image") == counts.end());
+    ASSERT_TRUE(counts.find(string("exam")) != counts.end());
+}
+
+TEST(test_erase_and_prefix_scan) {
+    Map<string, int> counts;
+    for (const char *word : {"exam", "euchre", "example", "examine",
+                             "image", "calculator", "exact"}) {
+        counts[word] = 1;
+    }
+    ASSERT_EQUAL(counts.erase("image"), 1);
+    ASSERT_EQUAL(counts.erase("image"), 0);
+    counts.erase(counts.find("calculator"));
+    ASSERT_EQUAL(counts.size(), 5);
+    ASSERT_EQUAL(counts.begin()->first, "euchre");
+
+    // Every word starting with "exam"
+    vector<string> words;
+    counts.visit_range("exam", "exan", [&words](pair<string, int> &p) {
+        words.push_back(p.first);
+    });
+    ASSERT_EQUAL(words, vector<string>({"exam", "examine", "example"}));
+    ASSERT_EQUAL(counts.lower_bound("exaa")->first, "exact");
+    ASSERT_TRUE(counts.upper_bound("example") == counts.end());
+    ASSERT_EQUAL(counts.equal_range("exam").first->first, "exam");
+}
+
+TEST(test_merge_counts) {
+    Map<string, int> shard1;
+    Map<string, int> shard2;
+    shard1["exam"] = 2;
+    shard1["euchre"] = 1;
+    shard2["exam"] = 3;
+    shard2["image"] = 4;
+
+    Map<string, int> kept(shard1);
+    kept.merge(shard2);
+    ASSERT_EQUAL(kept["exam"], 2);
+    ASSERT_EQUAL(kept["image"], 4);
+
+    shard1.merge(shard2, [](int &mine, const int &theirs) {
+        mine += theirs;
+    });
+    ASSERT_EQUAL(shard1.size(), 3);
+    ASSERT_EQUAL(shard1["exam"], 5);
+    ASSERT_EQUAL(shard1["euchre"], 1);
+    ASSERT_EQUAL(shard1["image"], 4);
+    ASSERT_EQUAL(shard2["exam"], 3);
+}
+
+TEST(test_splay_map) {
+    Map<string, int, less<string>, bst_splay> counts;
+    for (const char *word : {"exam", "euchre", "exam", "image", "bob",
+                             "exam", "dealer", "euchre"}) {
+        ++counts[word];
+    }
+    ASSERT_EQUAL(counts.size(), 5);
+    ASSERT_EQUAL(counts.find("exam")->second, 3);
+    ASSERT_EQUAL(counts.access("euchre")->second, 2);
+    ASSERT_TRUE(counts.access("piazza") == counts.end());
+    ASSERT_EQUAL(counts.begin()->first, "bob");
+    ASSERT_EQUAL(counts.rank("exam"), 3);
+}
+
+TEST_MAIN()
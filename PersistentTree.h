@@ -0,0 +1,405 @@
+#ifndef PERSISTENT_TREE_H
+#define PERSISTENT_TREE_H
+
+#include <cassert>  //assert
+#include <cstddef>  //ptrdiff_t
+#include <functional> //less
+#include <iterator> //forward_iterator_tag
+#include <memory>   //shared_ptr, make_shared
+#include <utility>  //move
+#include <vector>
+#include <algorithm> //max
+
+// A sorted set whose versions never change once built. Nodes are
+// immutable and reference counted, so any number of trees can share
+// them. Copying a PersistentTree takes a snapshot in O(1) time. Inserting
+// or erasing copies only the O(log n) nodes on the path to the change,
+// rebalancing with AVL rotations, and every other node stays shared with
+// the older versions. A version can be read from any number of threads
+// while another thread builds newer versions from it, because nothing a
+// reader can reach is ever modified. The PersistentTree object itself is
+// an ordinary value: one thread at a time may modify a given object.
+template <typename T,
+          typename Compare=std::less<T> // default if argument isn't provided
+         >
+class PersistentTree {
+
+private:
+
+  struct Node;
+  using Link = std::shared_ptr<const Node>;
+
+  struct Node {
+    Node(const T &datum_in, Link left_in, Link right_in)
+      : datum(datum_in), left(std::move(left_in)), right(std::move(right_in)),
+        height(std::max(node_height(left), node_height(right)) + 1),
+        subtree_size(node_size(left) + node_size(right) + 1) { }
+
+    const T datum;
+    const Link left;
+    const Link right;
+    const int height;
+    const size_t subtree_size;
+  };
+
+public:
+
+  // Default constructor
+  PersistentTree() { }
+
+  // Copying, assigning and destroying a PersistentTree only changes
+  // reference counts. A copy is a snapshot: later changes to either tree
+  // do not affect the other.
+
+  // EFFECTS: Returns a copy of this tree. Same as the copy constructor.
+  PersistentTree snapshot() const {
+    return *this;
+  }
+
+  // EFFECTS: Returns whether this PersistentTree is empty.
+  bool empty() const {
+    return root == nullptr;
+  }
+
+  // EFFECTS: Returns the height of the tree.
+  size_t height() const {
+    return static_cast<size_t>(node_height(root));
+  }
+
+  // EFFECTS: Returns the number of elements in this PersistentTree.
+  size_t size() const {
+    return node_size(root);
+  }
+
+  class Iterator {
+    // OVERVIEW: Iterator interface for PersistentTree. Iterates over the
+    //           elements in ascending order. Nodes have no parent links,
+    //           since a node can belong to many versions, so an Iterator
+    //           holds the path from the root to the current node. It stays
+    //           valid as long as some PersistentTree holds the version it
+    //           came from.
+
+  public:
+    // Member types so standard algorithms accept an Iterator
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T *;
+    using reference = const T &;
+
+    Iterator() { }
+
+    // EFFECTS: Returns the current element by reference.
+    const T &operator*() const {
+      return path.back()->datum;
+    }
+
+    // EFFECTS: Returns the current element by pointer.
+    const T *operator->() const {
+      return &path.back()->datum;
+    }
+
+    // Prefix ++
+    Iterator &operator++() {
+      const Node *node = path.back();
+      if (node->right) {
+        // Next element is the minimum of the right subtree
+        push_min(node->right.get());
+      }
+      else {
+        // Otherwise, climb until we arrive from a left child
+        path.pop_back();
+        while (!path.empty() && path.back()->right.get() == node) {
+          node = path.back();
+          path.pop_back();
+        }
+      }
+      return *this;
+    }
+
+    // Postfix ++ (implemented in terms of prefix ++)
+    Iterator operator++(int) {
+      Iterator result(*this);
+      ++(*this);
+      return result;
+    }
+
+    bool operator==(const Iterator &rhs) const {
+      return current() == rhs.current();
+    }
+
+    bool operator!=(const Iterator &rhs) const {
+      return current() != rhs.current();
+    }
+
+  private:
+    friend class PersistentTree;
+
+    // The nodes from the root down to the current one, or empty for an
+    // end Iterator
+    std::vector<const Node *> path;
+
+    const Node *current() const {
+      return path.empty() ? nullptr : path.back();
+    }
+
+    // EFFECTS: Extends the path down to the minimum of 'node'.
+    void push_min(const Node *node) {
+      for (; node; node = node->left.get()) {
+        path.push_back(node);
+      }
+    }
+
+  }; // PersistentTree::Iterator
+  ////////////////////////////////////////
+
+  // EFFECTS : Returns an iterator to the first element
+  //           in this PersistentTree.
+  Iterator begin() const {
+    Iterator result;
+    result.push_min(root.get());
+    return result;
+  }
+
+  // EFFECTS: Returns an iterator to past-the-end.
+  Iterator end() const {
+    return Iterator();
+  }
+
+  // EFFECTS: Returns an Iterator to the minimum element in this
+  //          PersistentTree or an end Iterator if the tree is empty.
+  Iterator min_element() const {
+    return begin();
+  }
+
+  // EFFECTS: Returns an Iterator to the maximum element in this
+  //          PersistentTree or an end Iterator if the tree is empty.
+  Iterator max_element() const {
+    Iterator result;
+    for (const Node *node = root.get(); node; node = node->right.get()) {
+      result.path.push_back(node);
+    }
+    return result;
+  }
+
+  // EFFECTS: Searches this tree for an element equivalent to query.
+  //          Returns an iterator to the existing element if found,
+  //          and an end iterator otherwise.
+  Iterator find(const T &query) const {
+    return find_impl(query);
+  }
+
+  // EFFECTS: Same as above for a query of another type. Only available
+  //          if Compare is transparent.
+  template <typename Query, typename C = Compare,
+            typename = typename C::is_transparent>
+  Iterator find(const Query &query) const {
+    return find_impl(query);
+  }
+
+  // MODIFIES: this PersistentTree
+  // EFFECTS : Inserts item if no equivalent element is present, copying
+  //           the nodes on the path to it. Returns whether item was
+  //           inserted. Snapshots taken earlier are not affected.
+  bool insert(const T &item) {
+    bool inserted = false;
+    root = insert_impl(root, item, false, inserted);
+    return inserted;
+  }
+
+  // MODIFIES: this PersistentTree
+  // EFFECTS : Inserts item, replacing the equivalent element if there is
+  //           one. Returns whether item was new.
+  bool insert_or_assign(const T &item) {
+    bool inserted = false;
+    root = insert_impl(root, item, true, inserted);
+    return inserted;
+  }
+
+  // MODIFIES: this PersistentTree
+  // EFFECTS : Removes the element equivalent to value, if there is one,
+  //           copying the nodes on the path to it. Returns the number of
+  //           elements removed.
+  size_t erase(const T &value) {
+    bool erased = false;
+    root = erase_impl(root, value, erased);
+    return erased ? 1 : 0;
+  }
+
+  // EFFECTS: Same as above for a value of another type. Only available
+  //          if Compare is transparent.
+  template <typename Query, typename C = Compare,
+            typename = typename C::is_transparent>
+  size_t erase(const Query &value) {
+    bool erased = false;
+    root = erase_impl(root, value, erased);
+    return erased ? 1 : 0;
+  }
+
+  // EFFECTS: Returns whether the sorting invariant holds and whether the
+  //          heights of the two subtrees of every node differ by at most
+  //          one.
+  bool check_invariants() const {
+    return check_invariants_impl(root.get(), nullptr, nullptr);
+  }
+
+private:
+
+  // DATA REPRESENTATION
+  // The root node of this version, or null if it is empty.
+  Link root;
+
+  // An instance of the Compare type. Use this to compare elements.
+  Compare less;
+
+  // EFFECTS: Returns the stored height of the tree rooted at 'node',
+  //          which is 0 for an empty tree.
+  static int node_height(const Link &node) {
+    return node ? node->height : 0;
+  }
+
+  // EFFECTS: Returns the stored number of elements in the tree rooted at
+  //          'node', which is 0 for an empty tree.
+  static size_t node_size(const Link &node) {
+    return node ? node->subtree_size : 0;
+  }
+
+  // EFFECTS: Returns a new node.
+  static Link make_node(const T &datum, Link left, Link right) {
+    return std::make_shared<const Node>(datum, std::move(left),
+                                        std::move(right));
+  }
+
+  // REQUIRES: 'left' and 'right' are AVL trees whose heights differ by at
+  //           most two
+  // EFFECTS : Returns a new AVL tree holding 'left', 'datum' and 'right'
+  //           in order, rotating with fresh nodes if needed.
+  static Link balance_impl(const T &datum, Link left, Link right) {
+    int balance = node_height(left) - node_height(right);
+    if (balance > 1) {
+      if (node_height(left->left) >= node_height(left->right)) {
+        return make_node(left->datum, left->left,
+                         make_node(datum, left->right, std::move(right)));
+      }
+      const Node *pivot = left->right.get();
+      return make_node(pivot->datum,
+                       make_node(left->datum, left->left, pivot->left),
+                       make_node(datum, pivot->right, std::move(right)));
+    }
+    if (balance < -1) {
+      if (node_height(right->right) >= node_height(right->left)) {
+        return make_node(right->datum,
+                         make_node(datum, std::move(left), right->left),
+                         right->right);
+      }
+      const Node *pivot = right->left.get();
+      return make_node(pivot->datum,
+                       make_node(datum, std::move(left), pivot->left),
+                       make_node(right->datum, pivot->right, right->right));
+    }
+    return make_node(datum, std::move(left), std::move(right));
+  }
+
+  // MODIFIES: inserted
+  // EFFECTS : Returns the tree rooted at 'node' with 'item' inserted, or
+  //           with the equivalent element replaced by 'item' if 'replace'.
+  //           Returns 'node' itself if nothing changes.
+  // NOTE:    This function must be tree recursive.
+  Link insert_impl(const Link &node, const T &item, bool replace,
+                   bool &inserted) const {
+    if (node == nullptr) {
+      inserted = true;
+      return make_node(item, nullptr, nullptr);
+    }
+    if (less(item, node->datum)) {
+      Link left = insert_impl(node->left, item, replace, inserted);
+      if (left == node->left) return node;
+      return balance_impl(node->datum, std::move(left), node->right);
+    }
+    if (less(node->datum, item)) {
+      Link right = insert_impl(node->right, item, replace, inserted);
+      if (right == node->right) return node;
+      return balance_impl(node->datum, node->left, std::move(right));
+    }
+    if (!replace) return node;
+    return make_node(item, node->left, node->right);
+  }
+
+  // MODIFIES: erased
+  // EFFECTS : Returns the tree rooted at 'node' without the element
+  //           equivalent to 'value', or 'node' itself if there is none.
+  // NOTE:    This function must be tree recursive.
+  template <typename Query>
+  Link erase_impl(const Link &node, const Query &value,
+                  bool &erased) const {
+    if (node == nullptr) return node;
+    if (less(value, node->datum)) {
+      Link left = erase_impl(node->left, value, erased);
+      if (left == node->left) return node;
+      return balance_impl(node->datum, std::move(left), node->right);
+    }
+    if (less(node->datum, value)) {
+      Link right = erase_impl(node->right, value, erased);
+      if (right == node->right) return node;
+      return balance_impl(node->datum, node->left, std::move(right));
+    }
+    erased = true;
+    if (node->left == nullptr) return node->right;
+    if (node->right == nullptr) return node->left;
+    // The successor takes this node's place. It stays alive through
+    // 'node', which the caller still holds.
+    const Node *successor = node->right.get();
+    while (successor->left) {
+      successor = successor->left.get();
+    }
+    return balance_impl(successor->datum, node->left,
+                        erase_min_impl(node->right));
+  }
+
+  // REQUIRES: the tree rooted at 'node' is not empty
+  // EFFECTS : Returns the tree rooted at 'node' without its minimum.
+  // NOTE:    This function must be tree recursive.
+  static Link erase_min_impl(const Link &node) {
+    if (node->left == nullptr) return node->right;
+    return balance_impl(node->datum, erase_min_impl(node->left),
+                        node->right);
+  }
+
+  // EFFECTS: Implements find for any type of query, recording the path.
+  template <typename Query>
+  Iterator find_impl(const Query &query) const {
+    Iterator result;
+    const Node *node = root.get();
+    while (node) {
+      result.path.push_back(node);
+      if (less(query, node->datum)) {
+        node = node->left.get();
+      }
+      else if (less(node->datum, query)) {
+        node = node->right.get();
+      }
+      else {
+        return result;
+      }
+    }
+    return end();
+  }
+
+  // EFFECTS: Returns whether the tree rooted at 'node' is a sorted AVL
+  //          tree whose elements lie strictly between *lower and *upper
+  //          (a null bound is unbounded).
+  // NOTE:    This function must be tree recursive.
+  bool check_invariants_impl(const Node *node, const T *lower,
+                             const T *upper) const {
+    if (node == nullptr) return true;
+    if (lower && !less(*lower, node->datum)) return false;
+    if (upper && !less(node->datum, *upper)) return false;
+    int left = node_height(node->left);
+    int right = node_height(node->right);
+    if (left - right > 1 || right - left > 1) return false;
+    return check_invariants_impl(node->left.get(), lower, &node->datum)
+      && check_invariants_impl(node->right.get(), &node->datum, upper);
+  }
+}; // END of PersistentTree class
+
+#endif // PERSISTENT_TREE_H
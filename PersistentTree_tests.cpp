@@ -0,0 +1,127 @@
+//
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+#include "PersistentTree.h"
+#include "unit_test_framework.h"
+
+using namespace std;
+
+TEST(test_empty) {
+    PersistentTree<int> tree;
+    ASSERT_TRUE(tree.empty());
+    ASSERT_EQUAL(tree.size(), 0);
+    ASSERT_TRUE(tree.begin() == tree.end());
+    ASSERT_TRUE(tree.find(3) == tree.end());
+    ASSERT_TRUE(tree.max_element() == tree.end());
+    ASSERT_EQUAL(tree.erase(3), 0);
+}
+
+TEST(test_insert_sorted_is_balanced) {
+    PersistentTree<int> tree;
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(tree.insert(i));
+    }
+    ASSERT_FALSE(tree.insert(500));
+    ASSERT_EQUAL(tree.size(), 1000);
+    ASSERT_TRUE(tree.check_invariants());
+    ASSERT_TRUE(tree.height() <= 14);
+
+    int expected = 0;
+    for (int i : tree) {
+        ASSERT_EQUAL(i, expected++);
+    }
+    ASSERT_EQUAL(expected, 1000);
+    ASSERT_EQUAL(*tree.find(777), 777);
+    ASSERT_EQUAL(*tree.max_element(), 999);
+}
+
+TEST(test_snapshots_unchanged) {
+    PersistentTree<int> tree;
+    for (int i = 0; i < 100; i += 2) {
+        tree.insert(i);
+    }
+    PersistentTree<int> before = tree.snapshot();
+    for (int i = 1; i < 100; i += 2) {
+        tree.insert(i);
+    }
+    for (int i = 0; i < 100; i += 4) {
+        ASSERT_EQUAL(tree.erase(i), 1);
+    }
+    ASSERT_TRUE(tree.check_invariants());
+    ASSERT_EQUAL(tree.size(), 75);
+    ASSERT_TRUE(tree.find(4) == tree.end());
+
+    ASSERT_TRUE(before.check_invariants());
+    ASSERT_EQUAL(before.size(), 50);
+    ASSERT_EQUAL(*before.find(4), 4);
+    ASSERT_TRUE(before.find(5) == before.end());
+}
+
+TEST(test_erase_all) {
+    PersistentTree<int> tree;
+    for (int i = 0; i < 64; ++i) {
+        tree.insert((i * 29) % 64);
+    }
+    for (int i = 0; i < 64; ++i) {
+        ASSERT_EQUAL(tree.erase((i * 13) % 64), 1);
+        ASSERT_TRUE(tree.check_invariants());
+        ASSERT_EQUAL(tree.size(), size_t(63 - i));
+    }
+    ASSERT_TRUE(tree.empty());
+}
+
+// Orders pairs by their first member only
+struct First_less {
+    bool operator()(const pair<string, int> &lhs,
+                    const pair<string, int> &rhs) const {
+        return lhs.first < rhs.first;
+    }
+};
+
+TEST(test_insert_or_assign) {
+    PersistentTree<pair<string, int>, First_less> model;
+    model.insert({"exam", 1});
+    model.insert({"euchre", 2});
+    PersistentTree<pair<string, int>, First_less> old = model;
+    ASSERT_FALSE(model.insert({"exam", 5}));
+    ASSERT_EQUAL(model.find({"exam", 0})->second, 1);
+    ASSERT_FALSE(model.insert_or_assign({"exam", 5}));
+    ASSERT_EQUAL(model.find({"exam", 0})->second, 5);
+    ASSERT_EQUAL(old.find({"exam", 0})->second, 1);
+}
+
+TEST(test_readers_during_writes) {
+    // Readers scan a snapshot while the writer keeps changing the tree
+    PersistentTree<int> tree;
+    for (int i = 0; i < 2000; ++i) {
+        tree.insert(i);
+    }
+    PersistentTree<int> snapshot = tree;
+    vector<long> sums(4, 0);
+    vector<thread> readers;
+    for (size_t r = 0; r < sums.size(); ++r) {
+        readers.push_back(thread([&snapshot, &sums, r]() {
+            for (int pass = 0; pass < 20; ++pass) {
+                for (int i : snapshot) {
+                    sums[r] += i;
+                }
+            }
+        }));
+    }
+    for (int i = 0; i < 2000; i += 3) {
+        tree.erase(i);
+        tree.insert(2000 + i);
+    }
+    for (size_t r = 0; r < readers.size(); ++r) {
+        readers[r].join();
+        ASSERT_EQUAL(sums[r], 20L * 1999 * 2000 / 2);
+    }
+    ASSERT_TRUE(tree.check_invariants());
+}
+
+TEST_MAIN()
@@ -0,0 +1,135 @@
+// Compares Map with the bst_splay policy against the plain and AVL trees
+// on a skewed lookup stream: words drawn from the vocabulary of the
+// training file with Zipf's law, so the k-th most frequent word is looked
+// up about 1/k times as often as the most frequent one.
+//
+// Usage: Splay_benchmark.exe [TRAIN_FILE [LOOKUPS [PASSES]]]
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include "csvstream.h"
+#include "Map.h"
+
+using namespace std;
+
+// EFFECTS: Returns every word in the content column of the given file,
+//          in order, including repeats.
+static vector<string> read_words(const string &filename) {
+  csvstream csvin(filename, {"content"});
+  vector<string> words;
+  vector<string> row;
+  while (csvin >> row) {
+    istringstream source(row[0]);
+    string word;
+    while (source >> word) {
+      words.push_back(word);
+    }
+  }
+  return words;
+}
+
+// EFFECTS: Returns 'count' words drawn from the distinct words in 'words'
+//          by Zipf's law over their frequency ranks.
+static vector<string> zipf_stream(const vector<string> &words, size_t count) {
+  Map<string, int> counts;
+  for (const string &word : words) {
+    ++counts[word];
+  }
+  vector<pair<int, string>> ranked;
+  for (const auto &entry : counts) {
+    ranked.push_back(make_pair(-entry.second, entry.first));
+  }
+  sort(ranked.begin(), ranked.end());
+
+  vector<double> weights;
+  for (size_t rank = 1; rank <= ranked.size(); ++rank) {
+    weights.push_back(1.0 / rank);
+  }
+  mt19937 engine(280);
+  discrete_distribution<size_t> pick(weights.begin(), weights.end());
+  vector<string> stream;
+  for (size_t i = 0; i < count; ++i) {
+    stream.push_back(ranked[pick(engine)].second);
+  }
+  return stream;
+}
+
+// EFFECTS: Returns the seconds spent running fn.
+template <typename Function>
+static double time_it(Function fn) {
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  fn();
+  chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// EFFECTS: Counts the training words with a Map_type, times looking up
+//          every word of the stream with find, or with access if
+//          'adaptive', and prints one line with the fastest of 'passes'
+//          runs over the stream, which is less noisy than a single run.
+template <typename Map_type>
+static void benchmark(const string &name, const vector<string> &train,
+                      const vector<string> &stream, bool adaptive,
+                      int passes) {
+  Map_type counts;
+  for (const string &word : train) {
+    ++counts[word];
+  }
+  size_t height_before = counts.height();
+  long checksum = 0;
+  double lookup = 0;
+  for (int pass = 0; pass < passes; ++pass) {
+    checksum = 0;
+    double seconds = time_it([&]() {
+      for (const string &word : stream) {
+        typename Map_type::Iterator it = adaptive ? counts.access(word)
+                                                  : counts.find(word);
+        checksum += it->second;
+      }
+    });
+    if (pass == 0 || seconds < lookup) lookup = seconds;
+  }
+
+  cout << left << setw(22) << name << right << fixed << setprecision(4)
+       << setw(10) << lookup << setw(10) << height_before
+       << setw(10) << counts.height()
+       << "   (checksum " << checksum << ")\n";
+}
+
+int main(int argc, char **argv) {
+  string train_file = "w14-f15_instructor_student.csv";
+  size_t lookups = 2000000;
+  int passes = 5;
+  if (argc > 4) {
+    cout << "Usage: Splay_benchmark.exe [TRAIN_FILE [LOOKUPS [PASSES]]]"
+         << endl;
+    return 1;
+  }
+  if (argc > 1) train_file = argv[1];
+  if (argc > 2) lookups = strtoul(argv[2], nullptr, 10);
+  if (argc > 3) passes = atoi(argv[3]);
+
+  vector<string> train = read_words(train_file);
+  vector<string> stream = zipf_stream(train, lookups);
+  cout << train.size() << " training words, " << stream.size()
+       << " Zipf-distributed lookups, best of " << passes << " passes\n";
+  cout << left << setw(22) << "tree" << right << setw(10) << "lookup"
+       << setw(10) << "height" << setw(10) << "after" << "\n";
+
+  benchmark<Map<string, int, less<string>, bst_unbalanced>>(
+    "unbalanced", train, stream, false, passes);
+  benchmark<Map<string, int, less<string>, bst_avl>>(
+    "avl", train, stream, false, passes);
+  benchmark<Map<string, int, less<string>, bst_splay>>(
+    "splay, find", train, stream, false, passes);
+  benchmark<Map<string, int, less<string>, bst_splay>>(
+    "splay, access", train, stream, true, passes);
+}
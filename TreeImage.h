@@ -0,0 +1,595 @@
+#ifndef TREE_IMAGE_H
+#define TREE_IMAGE_H
+
+#include <cassert>  //assert
+#include <cstddef>  //ptrdiff_t
+#include <cstdint>  //uint32_t
+#include <cstring>  //memcmp, memcpy
+#include <exception>
+#include <fstream>
+#include <functional> //less
+#include <iostream> //ostream
+#include <iterator> //bidirectional_iterator_tag
+#include <string>
+#include <type_traits> //is_trivially_copyable, is_same
+#include <utility>  //pair
+#include <vector>
+
+// Image files given by name are memory mapped where POSIX mmap() is
+// available
+#if defined(__unix__) || defined(__APPLE__)
+#define TREE_IMAGE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// An image is a tree written to a file so that it can be searched where it
+// lies, without building any nodes. It holds a header, one fixed-size
+// record per element in ascending order, and a blob with the characters of
+// every string. A record holds the 32-bit indices of the left and right
+// children of its element and the element itself, with each std::string
+// replaced by its offset and length in the blob. Nothing in an image is a
+// pointer, so it can be mapped at any address. Images use the byte order
+// and struct layout of the machine that wrote them.
+//
+// save_image writes an image of a BinarySearchTree or a Map. TreeImage and
+// MapImage read them. A tree that never saves an image does not need this
+// header.
+
+// A custom exception type
+class tree_image_exception : public std::exception {
+public:
+  const char * what () const noexcept override {
+    return msg.c_str();
+  }
+  const std::string msg;
+  tree_image_exception(const std::string &msg) : msg(msg) {};
+};
+
+
+// A read-only view of a string in an image. Compares with std::string,
+// C strings and other image_strings the way std::string does.
+struct image_string {
+  const char *data;
+  size_t size;
+
+  image_string() : data(""), size(0) {}
+  image_string(const char *data, size_t size) : data(data), size(size) {}
+
+  std::string str() const { return std::string(data, size); }
+
+  // EFFECTS: Returns a negative number, zero or a positive number as
+  //          [a, a + a_size) is less than, equal to or greater than
+  //          [b, b + b_size).
+  static int compare(const char *a, size_t a_size,
+                     const char *b, size_t b_size) {
+    int result = std::memcmp(a, b, a_size < b_size ? a_size : b_size);
+    if (result != 0) return result;
+    return a_size < b_size ? -1 : (a_size > b_size ? 1 : 0);
+  }
+};
+
+inline bool operator<(const image_string &lhs, const image_string &rhs) {
+  return image_string::compare(lhs.data, lhs.size, rhs.data, rhs.size) < 0;
+}
+inline bool operator<(const image_string &lhs, const std::string &rhs) {
+  return image_string::compare(lhs.data, lhs.size,
+                               rhs.data(), rhs.size()) < 0;
+}
+inline bool operator<(const std::string &lhs, const image_string &rhs) {
+  return image_string::compare(lhs.data(), lhs.size(),
+                               rhs.data, rhs.size) < 0;
+}
+inline bool operator<(const image_string &lhs, const char *rhs) {
+  return image_string::compare(lhs.data, lhs.size,
+                               rhs, std::strlen(rhs)) < 0;
+}
+inline bool operator<(const char *lhs, const image_string &rhs) {
+  return image_string::compare(lhs, std::strlen(lhs),
+                               rhs.data, rhs.size) < 0;
+}
+inline bool operator==(const image_string &lhs, const std::string &rhs) {
+  return image_string::compare(lhs.data, lhs.size,
+                               rhs.data(), rhs.size()) == 0;
+}
+inline bool operator!=(const image_string &lhs, const std::string &rhs) {
+  return !(lhs == rhs);
+}
+
+inline std::ostream & operator<< (std::ostream &os, const image_string &s) {
+  return os.write(s.data, static_cast<std::streamsize>(s.size));
+}
+
+
+// How an element of type T is stored in an image. 'stored' is the type
+// kept in a record, and 'value_type' is what a TreeImage gives back.
+// Trivially copyable types are stored as they are.
+template <typename T>
+struct image_field {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Only trivially copyable types, std::string and pairs of "
+                "those can be stored in a tree image");
+  using stored = T;
+  using value_type = T;
+
+  static stored encode(const T &value, std::string &) {
+    return value;
+  }
+  static value_type decode(const stored &field, const char *, size_t) {
+    return field;
+  }
+};
+
+// A std::string is stored as its offset and length in the blob
+template <>
+struct image_field<std::string> {
+  struct stored {
+    uint32_t offset;
+    uint32_t size;
+  };
+  using value_type = image_string;
+
+  static stored encode(const std::string &value, std::string &blob) {
+    if (blob.size() + value.size() > UINT32_MAX) {
+      throw tree_image_exception("Tree image strings exceed 4 GiB");
+    }
+    stored field;
+    field.offset = static_cast<uint32_t>(blob.size());
+    field.size = static_cast<uint32_t>(value.size());
+    blob += value;
+    return field;
+  }
+  static value_type decode(const stored &field, const char *blob,
+                           size_t blob_size) {
+    if (size_t(field.offset) + field.size > blob_size) {
+      throw tree_image_exception("Corrupt tree image: string out of range");
+    }
+    return image_string(blob + field.offset, field.size);
+  }
+};
+
+// A pair stores both members
+template <typename First, typename Second>
+struct image_field<std::pair<First, Second>> {
+  struct stored {
+    typename image_field<First>::stored first;
+    typename image_field<Second>::stored second;
+  };
+  using value_type = std::pair<typename image_field<First>::value_type,
+                               typename image_field<Second>::value_type>;
+
+  static stored encode(const std::pair<First, Second> &value,
+                       std::string &blob) {
+    stored field;
+    field.first = image_field<First>::encode(value.first, blob);
+    field.second = image_field<Second>::encode(value.second, blob);
+    return field;
+  }
+  static value_type decode(const stored &field, const char *blob,
+                           size_t blob_size) {
+    return value_type(
+      image_field<First>::decode(field.first, blob, blob_size),
+      image_field<Second>::decode(field.second, blob, blob_size));
+  }
+};
+
+// The child index of a record that has no such child
+const uint32_t image_null = UINT32_MAX;
+
+// The first bytes of every image
+struct image_header {
+  char magic[8];
+  uint32_t count;
+  uint32_t root;
+  uint32_t record_size;
+  uint32_t blob_size;
+};
+
+// One element of an image and the indices of its children
+template <typename T>
+struct image_record {
+  uint32_t left;
+  uint32_t right;
+  typename image_field<T>::stored datum;
+};
+
+// EFFECTS: Returns the offset of the first record in an image of T.
+template <typename T>
+size_t image_records_offset() {
+  const size_t align = alignof(image_record<T>);
+  return (sizeof(image_header) + align - 1) / align * align;
+}
+
+
+// Builds an image from the elements of a tree, which are added in
+// ascending order and then linked by index.
+template <typename T>
+class tree_image_writer {
+public:
+  explicit tree_image_writer(size_t count) {
+    if (count >= image_null) {
+      throw tree_image_exception("Too many elements for a tree image");
+    }
+    records.reserve(count);
+  }
+
+  // EFFECTS: Adds the next element in ascending order and returns its
+  //          index.
+  uint32_t add(const T &datum) {
+    image_record<T> record;
+    record.left = record.right = image_null;
+    record.datum = image_field<T>::encode(datum, blob);
+    records.push_back(record);
+    return static_cast<uint32_t>(records.size() - 1);
+  }
+
+  // MODIFIES: this tree_image_writer
+  // EFFECTS : Links the elements added at indices [first, last) into a
+  //           perfectly balanced tree and returns the index of its root,
+  //           or image_null if the range is empty.
+  // NOTE:    This function must be tree recursive.
+  uint32_t link(uint32_t first, uint32_t last) {
+    if (first == last) return image_null;
+    uint32_t middle = first + (last - first) / 2;
+    records[middle].left = link(first, middle);
+    records[middle].right = link(middle + 1, last);
+    return middle;
+  }
+
+  // EFFECTS: Returns the number of elements added so far.
+  uint32_t size() const {
+    return static_cast<uint32_t>(records.size());
+  }
+
+  // EFFECTS: Writes the image, with its root at index root, to filename.
+  //          Throws tree_image_exception if writing fails.
+  void save(const std::string &filename, uint32_t root) const {
+    image_header header;
+    std::memcpy(header.magic, "BSTIMG1", 8);
+    header.count = static_cast<uint32_t>(records.size());
+    header.root = root;
+    header.record_size = sizeof(image_record<T>);
+    header.blob_size = static_cast<uint32_t>(blob.size());
+    const std::string padding(image_records_offset<T>() - sizeof(header),
+                              '\0');
+
+    std::ofstream fout(filename.c_str(), std::ios::binary);
+    fout.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    fout.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+    fout.write(reinterpret_cast<const char *>(records.data()),
+               static_cast<std::streamsize>(records.size() *
+                                            sizeof(image_record<T>)));
+    fout.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+    if (!fout) throw tree_image_exception("Error writing file: " + filename);
+  }
+
+private:
+  std::vector<image_record<T>> records;
+  std::string blob;
+};
+
+
+// Key extractors for TreeImage
+struct image_identity {
+  template <typename Value>
+  const Value & operator()(const Value &value) const {
+    return value;
+  }
+};
+
+struct image_first {
+  template <typename Pair>
+  const typename Pair::first_type & operator()(const Pair &value) const {
+    return value.first;
+  }
+};
+
+
+// OVERVIEW: A read-only view of an image of a BinarySearchTree<T>, which
+//           searches and iterates the image in place. Opening one maps the
+//           file, and then costs nothing per element: only the pages that
+//           lookups touch are ever read. Elements are given back as
+//           image_field<T>::value_type, so a std::string comes back as an
+//           image_string pointing into the image. Searches compare keys,
+//           taken from elements by KeyOf, with operator<, so the tree that
+//           wrote the image must have been sorted that way.
+template <typename T, typename KeyOf=image_identity>
+class TreeImage {
+public:
+  using value_type = typename image_field<T>::value_type;
+
+  // EFFECTS: Opens the image in filename. Throws tree_image_exception if
+  //          it cannot be read or is not an image of T.
+  explicit TreeImage(const std::string &filename)
+    : map_base(nullptr), map_size(0) {
+#ifdef TREE_IMAGE_MMAP
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode)
+        && st.st_size > 0) {
+      size_t size = static_cast<size_t>(st.st_size);
+      void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        map_base = p;
+        map_size = size;
+      }
+    }
+    if (fd >= 0) close(fd);
+    if (map_base) {
+      attach(static_cast<const char *>(map_base), map_size, filename);
+      return;
+    }
+#endif
+    std::ifstream fin(filename.c_str(), std::ios::binary);
+    if (!fin.is_open()) {
+      throw tree_image_exception("Error opening file: " + filename);
+    }
+    copy.assign(std::istreambuf_iterator<char>(fin),
+                std::istreambuf_iterator<char>());
+    attach(copy.data(), copy.size(), filename);
+  }
+
+  // REQUIRES: data is aligned like an image_record<T> and outlives this
+  //           TreeImage
+  // EFFECTS : Views an image already in memory. Throws
+  //           tree_image_exception if it is not an image of T.
+  TreeImage(const void *data, size_t size)
+    : map_base(nullptr), map_size(0) {
+    attach(static_cast<const char *>(data), size, "image in memory");
+  }
+
+  // Destructor
+  ~TreeImage() {
+#ifdef TREE_IMAGE_MMAP
+    if (map_base) munmap(map_base, map_size);
+#endif
+  }
+
+  // EFFECTS: Returns whether the image has no elements.
+  bool empty() const {
+    return count == 0;
+  }
+
+  // EFFECTS: Returns the number of elements in the image.
+  size_t size() const {
+    return count;
+  }
+
+  class Iterator {
+    // OVERVIEW: Iterator interface for TreeImage. Records are stored in
+    //           ascending order, so an Iterator is an index and moving it
+    //           reads the next record.
+
+  public:
+    // Member types so standard algorithms accept an Iterator
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = typename TreeImage::value_type;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type;
+
+    // Holds the current element so that -> can return a pointer to it
+    class pointer {
+    public:
+      explicit pointer(const value_type &value_in) : value(value_in) { }
+      const value_type *operator->() const { return &value; }
+    private:
+      value_type value;
+    };
+
+    Iterator()
+      : image(nullptr), index(0) { }
+
+    // EFFECTS: Returns the current element by value.
+    value_type operator*() const {
+      return image->value_at(index);
+    }
+
+    // EFFECTS: Returns the current element through a pointer-like object.
+    pointer operator->() const {
+      return pointer(image->value_at(index));
+    }
+
+    // Prefix ++
+    Iterator &operator++() {
+      ++index;
+      return *this;
+    }
+
+    // Postfix ++ (implemented in terms of prefix ++)
+    Iterator operator++(int) {
+      Iterator result(*this);
+      ++(*this);
+      return result;
+    }
+
+    // REQUIRES: this Iterator is not at the first element
+    // Prefix --
+    Iterator &operator--() {
+      --index;
+      return *this;
+    }
+
+    // Postfix -- (implemented in terms of prefix --)
+    Iterator operator--(int) {
+      Iterator result(*this);
+      --(*this);
+      return result;
+    }
+
+    bool operator==(const Iterator &rhs) const {
+      return image == rhs.image && index == rhs.index;
+    }
+
+    bool operator!=(const Iterator &rhs) const {
+      return !(*this == rhs);
+    }
+
+  private:
+    friend class TreeImage;
+
+    const TreeImage *image;
+    uint32_t index;
+
+    Iterator(const TreeImage *image_in, uint32_t index_in)
+      : image(image_in), index(index_in) { }
+
+  }; // TreeImage::Iterator
+  ////////////////////////////////////////
+
+  // EFFECTS : Returns an iterator to the first element in the image.
+  Iterator begin() const {
+    return Iterator(this, 0);
+  }
+
+  // EFFECTS: Returns an iterator to past-the-end.
+  Iterator end() const {
+    return Iterator(this, count);
+  }
+
+  // EFFECTS: Returns an Iterator to the minimum element in the image or
+  //          an end Iterator if it is empty.
+  Iterator min_element() const {
+    return begin();
+  }
+
+  // EFFECTS: Returns an Iterator to the maximum element in the image or
+  //          an end Iterator if it is empty.
+  Iterator max_element() const {
+    return Iterator(this, count == 0 ? 0 : count - 1);
+  }
+
+  // EFFECTS: Searches the image for an element whose key is equivalent to
+  //          query, which may be of any type that compares with the keys
+  //          through operator<. Returns an iterator to the element if
+  //          found, and an end iterator otherwise.
+  //          Throws tree_image_exception if the search runs into a child
+  //          index that is out of range, or descends more than size()
+  //          times, which only a corrupt image with a cycle can make it do.
+  template <typename Query>
+  Iterator find(const Query &query) const {
+    KeyOf key_of;
+    uint32_t index = root;
+    for (uint32_t steps = 0; index != image_null; ++steps) {
+      if (index >= count || steps == count) {
+        throw tree_image_exception("Corrupt tree image: bad child index");
+      }
+      value_type value = value_at(index);
+      if (query < key_of(value)) index = records[index].left;
+      else if (key_of(value) < query) index = records[index].right;
+      else return Iterator(this, index);
+    }
+    return end();
+  }
+
+private:
+  // The file mapping, if the image was opened by filename and mapped
+  void *map_base;
+  size_t map_size;
+
+  // The file contents, if the image was opened by filename and not mapped
+  std::vector<char> copy;
+
+  // The parts of the image
+  uint32_t count;
+  uint32_t root;
+  const image_record<T> *records;
+  const char *blob;
+  size_t blob_size;
+
+  // Disable copying; it would unmap the file twice
+  TreeImage(const TreeImage &);
+  TreeImage & operator=(const TreeImage &);
+
+  // MODIFIES: this TreeImage
+  // EFFECTS : Checks the header of the image at data and points the view
+  //           at its parts. Throws tree_image_exception if it is not an
+  //           image of T.
+  void attach(const char *data, size_t size, const std::string &name) {
+    assert(reinterpret_cast<uintptr_t>(data)
+           % alignof(image_record<T>) == 0);
+    image_header header;
+    if (size < sizeof(header)) {
+      throw tree_image_exception("Corrupt tree image: " + name);
+    }
+    std::memcpy(&header, data, sizeof(header));
+    const size_t offset = image_records_offset<T>();
+    if (std::string(header.magic, sizeof(header.magic))
+          != std::string("BSTIMG1", 8)
+        || header.record_size != sizeof(image_record<T>)
+        || (header.root == image_null) != (header.count == 0)
+        || (header.count != 0 && header.root >= header.count)
+        || size != offset + size_t(header.count) * header.record_size
+                   + header.blob_size) {
+      throw tree_image_exception("Corrupt tree image: " + name);
+    }
+    count = header.count;
+    root = header.root;
+    records = reinterpret_cast<const image_record<T> *>(data + offset);
+    blob = data + offset + size_t(count) * header.record_size;
+    blob_size = header.blob_size;
+  }
+
+  // REQUIRES: index < count
+  // EFFECTS : Returns the element at index. Throws tree_image_exception if
+  //           it refers to characters outside the blob.
+  value_type value_at(uint32_t index) const {
+    return image_field<T>::decode(records[index].datum, blob, blob_size);
+  }
+};
+
+// A read-only view of an image of a Map<Key_type, Value_type>. Searches
+// compare keys only.
+template <typename Key_type, typename Value_type>
+using MapImage = TreeImage<std::pair<Key_type, Value_type>, image_first>;
+
+
+template <typename T, typename Compare, typename Balance, typename Nodes>
+class BinarySearchTree;
+template <typename Key_type, typename Value_type, typename Key_compare,
+          typename Balance, typename Nodes>
+class Map;
+
+// REQUIRES: [first, last) holds 'count' elements in ascending order
+// EFFECTS : Writes those elements to filename as a perfectly balanced
+//           image of T. Throws tree_image_exception if writing fails.
+template <typename T, typename Iter>
+void save_image_range(Iter first, Iter last, size_t count,
+                      const std::string &filename) {
+  tree_image_writer<T> writer(count);
+  for (; first != last; ++first) {
+    writer.add(*first);
+  }
+  writer.save(filename, writer.link(0, writer.size()));
+}
+
+// EFFECTS: Writes the elements of tree to filename as an image that a
+//          TreeImage<T> can search in place. T must be trivially
+//          copyable, a std::string or a pair of those. Throws
+//          tree_image_exception if writing fails.
+template <typename T, typename Compare, typename Balance, typename Nodes>
+void save_image(const BinarySearchTree<T, Compare, Balance, Nodes> &tree,
+                const std::string &filename) {
+  static_assert(std::is_same<Compare, std::less<T>>::value,
+                "TreeImage searches elements with operator<");
+  save_image_range<T>(tree.begin(), tree.end(), tree.size(), filename);
+}
+
+// EFFECTS: Writes the pairs of map to filename as an image that a
+//          MapImage<Key_type, Value_type> can search in place, so a large
+//          table can be opened without being rebuilt. The key and value
+//          types must each be trivially copyable or a std::string. Throws
+//          tree_image_exception if writing fails.
+template <typename Key_type, typename Value_type, typename Key_compare,
+          typename Balance, typename Nodes>
+void save_image(const Map<Key_type, Value_type, Key_compare, Balance,
+                          Nodes> &map,
+                const std::string &filename) {
+  static_assert(std::is_same<Key_compare, std::less<Key_type>>::value,
+                "MapImage searches keys with operator<");
+  save_image_range<std::pair<Key_type, Value_type>>(
+    map.begin(), map.end(), map.size(), filename);
+}
+
+#endif // TREE_IMAGE_H
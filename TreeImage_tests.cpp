@@ -0,0 +1,181 @@
+//
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+
+#include "Map.h"
+#include "TreeImage.h"
+#include "unit_test_framework.h"
+
+using namespace std;
+
+static const string image_file = "TreeImage_tests.img";
+
+TEST(test_empty_image) {
+    BinarySearchTree<int> bst;
+    save_image(bst, image_file);
+    TreeImage<int> image(image_file);
+    ASSERT_TRUE(image.empty());
+    ASSERT_EQUAL(image.size(), 0);
+    ASSERT_TRUE(image.begin() == image.end());
+    ASSERT_TRUE(image.find(3) == image.end());
+    remove(image_file.c_str());
+}
+
+TEST(test_int_image) {
+    BinarySearchTree<int, less<int>, bst_avl> bst;
+    for (int i = 0; i < 1000; ++i) {
+        bst.insert((i * 37) % 1000);
+    }
+    save_image(bst, image_file);
+    TreeImage<int> image(image_file);
+    ASSERT_EQUAL(image.size(), 1000);
+    ASSERT_TRUE(equal(image.begin(), image.end(), bst.begin()));
+    for (int i = -1; i <= 1000; ++i) {
+        TreeImage<int>::Iterator it = image.find(i);
+        if (i < 0 || i == 1000) {
+            ASSERT_TRUE(it == image.end());
+        }
+        else {
+            ASSERT_EQUAL(*it, i);
+        }
+    }
+    ASSERT_EQUAL(*image.max_element(), 999);
+    ASSERT_EQUAL(*--image.end(), 999);
+    remove(image_file.c_str());
+}
+
+TEST(test_map_image) {
+    Map<string, int> counts;
+    istringstream words("the exam was the hardest exam of the term "
+                        "and the euchre project was fun");
+    string word;
+    while (words >> word) {
+        ++counts[word];
+    }
+    save_image(counts, image_file);
+
+    MapImage<string, int> image(image_file);
+    ASSERT_EQUAL(image.size(), counts.size());
+    ASSERT_EQUAL(image.find("the")->second, 4);
+    ASSERT_EQUAL(image.find(string("exam"))->second, 2);
+    ASSERT_TRUE(image.find("image") == image.end());
+    ASSERT_TRUE(image.find("th") == image.end());
+
+    Map<string, int>::Iterator expected = counts.begin();
+    for (MapImage<string, int>::Iterator it = image.begin();
+         it != image.end(); ++it, ++expected) {
+        ASSERT_EQUAL(it->first.str(), expected->first);
+        ASSERT_EQUAL((*it).second, expected->second);
+    }
+    ASSERT_TRUE(expected == counts.end());
+    remove(image_file.c_str());
+}
+
+TEST(test_image_in_memory) {
+    BinarySearchTree<string> bst;
+    for (const char *word : {"exam", "euchre", "calculator", "bob"}) {
+        bst.insert(word);
+    }
+    save_image(bst, image_file);
+    ifstream fin(image_file.c_str(), ios::binary);
+    vector<char> bytes((istreambuf_iterator<char>(fin)),
+                       istreambuf_iterator<char>());
+
+    TreeImage<string> image(bytes.data(), bytes.size());
+    ASSERT_EQUAL(image.size(), 4);
+    ASSERT_EQUAL(image.begin()->str(), "bob");
+    ASSERT_TRUE(image.find("euchre") != image.end());
+    ASSERT_TRUE(*image.find("euchre") == string("euchre"));
+
+    // A truncated image is rejected
+    bool thrown = false;
+    try {
+        TreeImage<string> truncated(bytes.data(), bytes.size() - 1);
+    }
+    catch (const tree_image_exception &) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown);
+
+    // So is an image of another type
+    thrown = false;
+    try {
+        MapImage<string, int> wrong(bytes.data(), bytes.size());
+    }
+    catch (const tree_image_exception &) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown);
+    remove(image_file.c_str());
+}
+
+// EFFECTS: Returns the bytes of the image in image_file.
+static vector<char> read_image_file() {
+    ifstream fin(image_file.c_str(), ios::binary);
+    return vector<char>((istreambuf_iterator<char>(fin)),
+                        istreambuf_iterator<char>());
+}
+
+TEST(test_corrupt_image) {
+    BinarySearchTree<int> bst;
+    for (int i : {1, 2, 3}) {
+        bst.insert(i);
+    }
+    save_image(bst, image_file);
+    vector<char> bytes = read_image_file();
+    // Saved balanced, so the root is the middle record
+    const size_t records = image_records_offset<int>();
+    image_record<int> *record
+      = reinterpret_cast<image_record<int> *>(bytes.data() + records);
+    ASSERT_EQUAL(record[1].datum, 2);
+
+    // A child index past the last record
+    record[1].left = 7;
+    bool thrown = false;
+    try {
+        TreeImage<int> image(bytes.data(), bytes.size());
+        image.find(1);
+    }
+    catch (const tree_image_exception &) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown);
+
+    // A cycle
+    record[1].left = 1;
+    thrown = false;
+    try {
+        TreeImage<int> image(bytes.data(), bytes.size());
+        image.find(0);
+    }
+    catch (const tree_image_exception &) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown);
+
+    // A string past the end of the blob
+    BinarySearchTree<string> words;
+    words.insert("euchre");
+    save_image(words, image_file);
+    bytes = read_image_file();
+    image_record<string> *word = reinterpret_cast<image_record<string> *>(
+        bytes.data() + image_records_offset<string>());
+    word->datum.size = 7;
+    TreeImage<string> image(bytes.data(), bytes.size());
+    thrown = false;
+    try {
+        *image.begin();
+    }
+    catch (const tree_image_exception &) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown);
+    remove(image_file.c_str());
+}
+
+TEST_MAIN()
@@ -0,0 +1,147 @@
+#ifndef TREE_LINKS_H
+#define TREE_LINKS_H
+
+#include <cassert>  //assert
+
+// Relinking and AVL rebalancing shared by the trees whose nodes link to
+// their children and their parent and store their height: the Nodes of
+// BinarySearchTree, and the objects of an IntrusiveTree, whose links are
+// in a bst_hook. The two trees keep their links in different places, so
+// Links tells how to reach them. It provides
+//   using Node = ...;                      the type the links point to
+//   static Node *& left(Node *node);       the links of a non-null node
+//   static Node *& right(Node *node);
+//   static Node *& parent(Node *node);
+//   static int height(const Node *node);   the stored height, 0 for null
+//   static void update(Node *node);        recomputes what a node stores
+//                                          about its subtree, such as its
+//                                          height, from its children
+template <typename Links>
+class tree_links {
+public:
+  using Node = typename Links::Node;
+
+  // MODIFIES: the tree rooted at 'node'
+  // EFFECTS : Rotates 'node' down to the right below its left child and
+  //           returns the left child, which is the new root of the subtree.
+  //           The link to it from node's parent is left to the caller.
+  static Node * rotate_right(Node *node) {
+    Node *pivot = Links::left(node);
+    Links::left(node) = Links::right(pivot);
+    if (Links::left(node)) Links::parent(Links::left(node)) = node;
+    Links::right(pivot) = node;
+    Links::parent(pivot) = Links::parent(node);
+    Links::parent(node) = pivot;
+    Links::update(node);
+    Links::update(pivot);
+    return pivot;
+  }
+
+  // MODIFIES: the tree rooted at 'node'
+  // EFFECTS : Rotates 'node' down to the left below its right child and
+  //           returns the right child, which is the new root of the subtree.
+  //           The link to it from node's parent is left to the caller.
+  static Node * rotate_left(Node *node) {
+    Node *pivot = Links::right(node);
+    Links::right(node) = Links::left(pivot);
+    if (Links::right(node)) Links::parent(Links::right(node)) = node;
+    Links::left(pivot) = node;
+    Links::parent(pivot) = Links::parent(node);
+    Links::parent(node) = pivot;
+    Links::update(node);
+    Links::update(pivot);
+    return pivot;
+  }
+
+  // REQUIRES: the subtrees of 'node' are AVL trees whose heights differ by
+  //           at most two
+  // MODIFIES: the tree rooted at 'node'
+  // EFFECTS : Restores the AVL invariant at 'node' with one or two
+  //           rotations and returns the new root of the subtree.
+  static Node * rebalance_avl(Node *node) {
+    Node *left = Links::left(node);
+    Node *right = Links::right(node);
+    int balance = Links::height(left) - Links::height(right);
+    if (balance > 1) {
+      if (Links::height(Links::left(left))
+          < Links::height(Links::right(left))) {
+        Links::left(node) = rotate_left(left);
+      }
+      return rotate_right(node);
+    }
+    if (balance < -1) {
+      if (Links::height(Links::right(right))
+          < Links::height(Links::left(right))) {
+        Links::right(node) = rotate_right(right);
+      }
+      return rotate_left(node);
+    }
+    return node;
+  }
+
+  // MODIFIES: root, the tree
+  // EFFECTS : Walks from 'node' up to the root, updating each node on the
+  //           way and replacing it with what rebalance(node) returns,
+  //           which is the new root of its subtree.
+  template <typename Rebalance>
+  static void retrace(Node *&root, Node *node, Rebalance rebalance) {
+    while (node) {
+      Node *above = Links::parent(node);
+      bool is_left = above && Links::left(above) == node;
+      Links::update(node);
+      Node *subtree = rebalance(node);
+      if (above == nullptr) root = subtree;
+      else if (is_left) Links::left(above) = subtree;
+      else Links::right(above) = subtree;
+      node = above;
+    }
+  }
+
+  // MODIFIES: root, the tree
+  // EFFECTS : Makes 'replacement', which may be null, take the place of
+  //           'node' as a child of node's parent, or as the root.
+  static void replace_child(Node *&root, Node *node, Node *replacement) {
+    Node *parent = Links::parent(node);
+    if (parent == nullptr) root = replacement;
+    else if (Links::left(parent) == node) Links::left(parent) = replacement;
+    else Links::right(parent) = replacement;
+    if (replacement) Links::parent(replacement) = parent;
+  }
+
+  // MODIFIES: root, the tree
+  // EFFECTS : Unlinks 'node' from the tree, putting its in-order successor
+  //           in its place if it has two children. Other nodes are
+  //           relinked rather than having their contents moved. Returns
+  //           the lowest node whose subtree changed, where retracing
+  //           should start, or null if that is none. The links of 'node'
+  //           itself are left as they were.
+  static Node * unlink(Node *&root, Node *node) {
+    Node *left = Links::left(node);
+    Node *right = Links::right(node);
+    if (left == nullptr || right == nullptr) {
+      Node *start = Links::parent(node);
+      replace_child(root, node, left ? left : right);
+      return start;
+    }
+    Node *successor = right;
+    while (Links::left(successor)) successor = Links::left(successor);
+    Node *start;
+    if (successor == right) {
+      start = successor;
+    }
+    else {
+      start = Links::parent(successor);
+      Links::left(start) = Links::right(successor);
+      if (Links::left(start)) Links::parent(Links::left(start)) = start;
+      Links::right(successor) = right;
+      Links::parent(right) = successor;
+    }
+    Links::left(successor) = left;
+    Links::parent(left) = successor;
+    replace_child(root, node, successor);
+    assert(start != nullptr);
+    return start;
+  }
+};
+
+#endif // TREE_LINKS_H
@@ -10,8 +10,8 @@
 
 static const char* const c_leaf_branch_special = "/\\";
 
-template <typename U, typename C>
-class BinarySearchTree<U, C>::Tree_grid_square {
+template <typename U, typename C, typename B, typename N>
+class BinarySearchTree<U, C, B, N>::Tree_grid_square {
 public:
   template<typename T>
   Tree_grid_square(int x_, int y_, T value_) : x(x_), y(y_) {
@@ -52,8 +52,8 @@ private:
 };
 
 
-template <typename U, typename C>
-class BinarySearchTree<U, C>::Tree_grid {
+template <typename U, typename C, typename B, typename N>
+class BinarySearchTree<U, C, B, N>::Tree_grid {
 public:
 
   Tree_grid(const BinarySearchTree& tree) :
@@ -149,8 +149,8 @@ private:
   } // build
 };
 
-template <typename U, typename C>
-std::string BinarySearchTree<U, C>::to_string() const {
+template <typename U, typename C, typename B, typename N>
+std::string BinarySearchTree<U, C, B, N>::to_string() const {
     if (!root) {
         return "( )";
     }
@@ -198,8 +198,8 @@ static const int c_min_elt_width = 2;
 /*
  * Returns the width of the widest elt in this tree.
  */
-template <typename U, typename C>
-int BinarySearchTree<U, C>::get_max_elt_width() const {
+template <typename U, typename C, typename B, typename N>
+int BinarySearchTree<U, C, B, N>::get_max_elt_width() const {
     int current_max = c_min_elt_width;
     std::stack<Node*> nodes;
     nodes.push(root);
@@ -8,9 +8,29 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <algorithm>
 #include <regex>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <random>
+#include <set>
+#include <cstdint>
 #include <exception>
 
+// Files given by name are memory mapped where POSIX mmap() is available
+#if defined(__unix__) || defined(__APPLE__)
+#define CSVSTREAM_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 
 // A custom exception type
 class csvstream_exception : public std::exception {
@@ -23,15 +43,213 @@ public:
 };
 
 
+// A read-only view of one field.  Produced by
+// csvstream::operator>>(std::vector<csvfield>&).
+struct csvfield {
+  const char *data;
+  size_t size;
+
+  csvfield() : data(""), size(0) {}
+  csvfield(const char *data, size_t size) : data(data), size(size) {}
+
+  std::string str() const { return std::string(data, size); }
+
+  bool operator==(const std::string &rhs) const {
+    return rhs.size() == size && rhs.compare(0, size, data, size) == 0;
+  }
+  bool operator!=(const std::string &rhs) const { return !(*this == rhs); }
+};
+
+inline std::ostream & operator<< (std::ostream &os, const csvfield &field) {
+  return os.write(field.data, static_cast<std::streamsize>(field.size));
+}
+
+
+// A batch of rows stored by column.  For each selected column, the fields of
+// every row are stored back to back in one buffer, and field r occupies
+// [offsets[r], offsets[r+1]) of it.  Filled by csvstream::read_batch().
+// Reusing one batch across reads reuses its storage.
+class csvbatch {
+public:
+  csvbatch() : rows(0) {}
+
+  size_t num_rows() const { return rows; }
+  size_t num_columns() const { return columns.size(); }
+
+  // Contiguous contents of all fields of a column
+  const std::string & chars(size_t column) const {
+    return columns[column].chars;
+  }
+
+  // Start of each field of a column within chars(), plus one past the end
+  const std::vector<size_t> & offsets(size_t column) const {
+    return columns[column].offsets;
+  }
+
+  // View of one field
+  csvfield field(size_t column, size_t row) const {
+    const column_data &c = columns[column];
+    return csvfield(c.chars.data() + c.offsets[row],
+                    c.offsets[row + 1] - c.offsets[row]);
+  }
+
+  // Remove all rows, keeping allocated storage
+  void clear(size_t num_columns) {
+    columns.resize(num_columns);
+    for (size_t i=0; i<columns.size(); ++i) {
+      columns[i].chars.clear();
+      columns[i].offsets.assign(1, 0);
+    }
+    rows = 0;
+  }
+
+private:
+  friend class csv_batch_fields;
+
+  struct column_data {
+    std::string chars;
+    std::vector<size_t> offsets;
+  };
+
+  std::vector<column_data> columns;
+  size_t rows;
+};
+
+
+// A character source over a block of memory, such as a memory mapped file.
+// Provides the parts of the std::istream interface used by read_csv_line().
+class csv_buffer {
+public:
+  csv_buffer() : first(nullptr), next(nullptr), last(nullptr), failed(false) {}
+  csv_buffer(const char *first, const char *last)
+    : first(first), next(first), last(last), failed(false) {}
+
+  bool get(char &c) {
+    if (next == last) {
+      failed = true;
+      return false;
+    }
+    c = *next++;
+    return true;
+  }
+  void unget() { --next; }
+  void clear() { failed = false; }
+  explicit operator bool() const { return !failed; }
+
+  // Position of the next character to be read
+  const char * pos() const { return next; }
+
+private:
+  const char *first;
+  const char *next;
+  const char *last;
+  bool failed;
+};
+
+
+// A bounded queue for one producer thread and one consumer thread.  push()
+// and pop() never lock or wait; they return false when the queue is full or
+// empty.  Elements are exchanged with swap(), so the storage of consumed
+// elements is handed back to the producer for reuse.
+template <typename T>
+class csv_ring {
+public:
+  explicit csv_ring(size_t capacity) : slots(capacity), head(0), tail(0) {
+    assert(capacity > 0);
+  }
+
+  // Called only by the producer
+  bool push(T &item) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) == slots.size()) return false;
+    slots[t % slots.size()].swap(item);
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Called only by the consumer
+  bool pop(T &item) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) return false;
+    item.swap(slots[h % slots.size()]);
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  std::vector<T> slots;
+
+  // Next slot to pop and next slot to push, kept on separate cache lines
+  std::atomic<size_t> head;
+  char padding[64];
+  std::atomic<size_t> tail;
+};
+
+
+// State shared between a csvstream and its read-ahead thread.  Rows pass
+// through the lock-free ring.  A thread that finds the ring full or empty
+// sleeps on a condition variable instead of spinning; it sets its waiting
+// flag first, and the other thread only locks the mutex to wake it when
+// that flag is set.  Sequentially consistent fences between each thread's
+// update and its check of the other's flag make sure that one of the two
+// sees the other, so no wakeup is lost.
+struct csv_readahead {
+  explicit csv_readahead(size_t capacity)
+    : rows(capacity), stop(false), done(false),
+      producer_waiting(false), consumer_waiting(false) {}
+
+  csv_ring<std::vector<std::string> > rows;
+
+  // Set by the consumer to ask the producer to exit
+  std::atomic<bool> stop;
+
+  // Set by the producer once it has pushed its last row, after error
+  std::atomic<bool> done;
+  std::exception_ptr error;
+
+  // Sleeping while the ring is full or empty
+  std::mutex mutex;
+  std::condition_variable room;
+  std::condition_variable ready;
+  std::atomic<bool> producer_waiting;
+  std::atomic<bool> consumer_waiting;
+
+  std::thread thread;
+};
+
+
+class csvindex;
+
+
 // csvstream interface
+//
+// Fields may be quoted with double quotes, and a doubled double quote inside
+// quotes stands for one.  A backslash, in or out of quotes, is dropped and
+// the character after it is kept as is, so \" is a double quote and \\ is a
+// backslash.  csvwriter writes fields in a form this reads back unchanged.
 class csvstream {
 public:
+  // Rows of selected fields, as produced by operator>>(vector<string>&)
+  typedef std::vector<std::vector<std::string> > rows_type;
+
   // Constructor from filename. Throws csvstream_exception if open fails.
+  // Regular files are memory mapped and parsed in place; anything that
+  // cannot be mapped, such as a pipe or /dev/stdin, is read with ifstream.
   csvstream(const std::string &filename, char delimiter=',', bool strict=true);
 
   // Constructor from stream
   csvstream(std::istream &is, char delimiter=',', bool strict=true);
 
+  // Constructors that keep only the named columns.  Column names are resolved
+  // to indices once, when the header is read, and all other columns are
+  // skipped without being stored.  Throws csvstream_exception if open fails
+  // or if a column is missing from the header.
+  csvstream(const std::string &filename,
+            const std::vector<std::string> &columns,
+            char delimiter=',', bool strict=true);
+  csvstream(std::istream &is, const std::vector<std::string> &columns,
+            char delimiter=',', bool strict=true);
+
   // Destructor
   ~csvstream();
 
@@ -41,6 +259,11 @@ public:
   // Return header processed by constructor
   std::vector<std::string> getheader() const;
 
+  // Return the position of column name within the rows produced by
+  // operator>>(std::vector<std::string>&).  Look this up once, before the
+  // read loop.  Throws csvstream_exception if the column was not selected.
+  size_t column_index(const std::string &name) const;
+
   // Stream extraction operator reads one row. Throws csvstream_exception if
   // the number of items in a row does not match the header.
   csvstream & operator>> (std::map<std::string, std::string>& row);
@@ -50,7 +273,64 @@ public:
   // header.
   csvstream & operator>> (std::vector<std::pair<std::string, std::string> >& row);
 
+  // Stream extraction operator reads the selected columns of one row, in
+  // column_index() order.  Reuses the storage already held by row.  Throws
+  // csvstream_exception if the number of items in a row does not match the
+  // header.
+  csvstream & operator>> (std::vector<std::string>& row);
+
+  // Stream extraction operator reads the selected columns of one row as views,
+  // in column_index() order.  When the file is memory mapped, the views point
+  // into the mapping (or, for fields that contained quotes or escapes, into
+  // storage owned by this csvstream) and stay valid until the csvstream is
+  // destroyed.  Otherwise, they are valid until the next read.  Throws
+  // csvstream_exception if the number of items in a row does not match the
+  // header.
+  csvstream & operator>> (std::vector<csvfield>& row);
+
+  // Return true if the input is memory mapped
+  bool is_mapped() const;
+
+  // Read up to max_rows rows into batch, replacing its contents, and return
+  // the number of rows read.  Returns 0 at the end of the input.  Throws
+  // csvstream_exception if the number of items in a row does not match the
+  // header.
+  size_t read_batch(csvbatch &batch, size_t max_rows);
+
+  // Read every remaining row using num_threads threads, or one per core if
+  // num_threads is 0.  A mapped file is split into byte ranges, and a
+  // quote-aware pre-pass moves each split to the start of a record, so quoted
+  // fields may contain line endings.  Rows are returned in file order.  Input
+  // that is not mapped is read on the calling thread.  Throws
+  // csvstream_exception if the number of items in a row does not match the
+  // header.
+  rows_type read_all(unsigned num_threads=0);
+
+  // Like read_all(), but hands the rows to fn in batches, one batch per
+  // chunk, in whatever order the chunks finish.  fn is called concurrently
+  // from worker threads and may take the contents of its argument.
+  void read_all_unordered(unsigned num_threads,
+                          const std::function<void(rows_type &)> &fn);
+
+  // Position the stream so that the next read returns data row number row,
+  // counting from 0 after the header, using an index built for this file.
+  // Throws csvstream_exception if row is out of range or the underlying
+  // stream cannot seek.
+  void seek_row(const csvindex &index, size_t row);
+
+  // Start a thread that reads and parses rows ahead of the caller into a
+  // queue of up to capacity rows, so that I/O and parsing overlap with
+  // whatever the caller does with each row.  The thread waits while the
+  // queue is full and exits when the csvstream is destroyed.  An exception
+  // thrown while reading ahead is rethrown by the read that reaches it.
+  // While reading ahead, read_batch() and seek_row() throw
+  // csvstream_exception, and rows read as views are copies that are valid
+  // until the next read.
+  void start_readahead(size_t capacity=1024);
+
 private:
+  friend class csvindex;
+
   // Filename.  Used for error messages.
   std::string filename;
 
@@ -60,6 +340,20 @@ private:
   // Stream in CSV format
   std::istream &is;
 
+  // Memory mapped file contents, used instead of is when map_base is non-null
+  const char *map_base;
+  size_t map_size;
+  csv_buffer buf;
+
+  // Unescaped copies of mapped fields that could not be viewed in place
+  std::deque<std::string> field_copies;
+
+  // Read-ahead thread and queue, if started
+  std::unique_ptr<csv_readahead> ahead;
+
+  // Whether the consumer has seen the end of the read-ahead queue
+  bool ahead_eof;
+
   // Delimiter between columns
   char delimiter;
 
@@ -74,30 +368,414 @@ private:
   // Store header column names
   std::vector<std::string> header;
 
-  // Process header, the first line of the file
+  // Names of the selected columns, in output order.  Empty until the header
+  // is read if the caller selected every column.
+  std::vector<std::string> columns;
+
+  // For each header column, its position in columns, or -1 if skipped
+  std::vector<int> column_slots;
+
+  // Scratch row reused by the map and pair extraction operators
+  std::vector<std::string> fields;
+
+  // Open filename, memory mapping it if possible
+  void open(const std::string &filename);
+
+  // Read one line from the mapped buffer or the stream
+  template <typename Sink>
+  bool read_line(Sink &sink);
+
+  // Throw csvstream_exception if a row of length n is not allowed
+  void check_row_length(size_t n) const;
+
+  // Byte offset of the next character to be read
+  uint64_t tell();
+
+  // Read past one row without storing it.  Returns false at the end.
+  bool skip_row();
+
+  // Number of chunks to split the rest of the mapped buffer into
+  size_t num_chunks(unsigned num_threads) const;
+
+  // Parse the rest of the mapped buffer as n chunks, one thread per chunk,
+  // passing each chunk's index and rows to deliver on its worker thread.
+  void parse_chunks(size_t n,
+                    const std::function<void(size_t, rows_type &)> &deliver);
+
+  // Process header, the first line of the file, and bind selected columns
   void read_header();
 
+  // Read the selected fields of one row into data, from the read-ahead queue
+  // if there is one.  Returns false at the end of the stream.  Throws
+  // csvstream_exception on a row length mismatch.
+  bool read_row(std::vector<std::string> &data);
+
+  // Parse the selected fields of one row from the input into data
+  bool parse_row(std::vector<std::string> &data);
+
+  // Body of the read-ahead thread
+  void produce_rows();
+
+  // Take the next row from the read-ahead queue, waiting if it is empty
+  bool pop_row(std::vector<std::string> &data);
+
+  // Stop and join the read-ahead thread, if any
+  void stop_readahead();
+
+  // Throw csvstream_exception if reading ahead, since operation would race
+  // with the read-ahead thread
+  void check_not_ahead(const char *operation) const;
+
   // Disable copying because copying streams is bad!
   csvstream(const csvstream &);
   csvstream & operator= (const csvstream &);
 };
 
-// Read and tokenize one line from a stream
-static bool read_csv_line(std::istream &is,
-                          std::vector<std::string> &data,
+
+// The byte offsets at which the data rows of a CSV file begin, recorded for
+// every stride-th row.  Seeking to row k costs one lookup plus skipping at
+// most stride-1 rows, so with a stride of 1 it is O(1).  An index is saved
+// as a side-car file, conventionally the data filename plus ".idx", along
+// with the size and modification time of the file it describes so that a
+// stale index is detected.  The format uses the host's byte order.
+class csvindex {
+public:
+  csvindex() : row_stride(1), row_count(0), file_size(0), file_mtime(0) {}
+
+  // Build an index of filename in one pass.  Throws csvstream_exception if
+  // the file cannot be read.
+  static csvindex build(const std::string &filename, size_t stride=1);
+
+  // Load an index saved by save() for the file filename.  Throws
+  // csvstream_exception if the index cannot be read, is corrupt, or does not
+  // match the current contents of filename.
+  static csvindex load(const std::string &filename,
+                       const std::string &index_filename);
+
+  // Load filename + ".idx", or build and save it if it is missing or stale.
+  // If it cannot be saved, the index that was built is returned anyway.
+  static csvindex open(const std::string &filename, size_t stride=1);
+
+  // Write this index to index_filename.  Throws csvstream_exception on
+  // failure.
+  void save(const std::string &index_filename) const;
+
+  // Number of data rows in the indexed file
+  size_t num_rows() const { return row_count; }
+
+  // Distance in rows between recorded offsets
+  size_t stride() const { return row_stride; }
+
+  // REQUIRES: row < num_rows()
+  // EFFECTS:  Returns the offset of the nearest recorded row at or before row.
+  uint64_t checkpoint(size_t row) const {
+    assert(row < row_count);
+    return offsets[row / row_stride];
+  }
+
+  // EFFECTS: Splits rows [0, num_rows()) into n contiguous [first, last)
+  //          ranges whose sizes differ by at most one, for example to give
+  //          each worker or cross-validation fold its own rows.
+  std::vector<std::pair<size_t, size_t> > split(size_t n) const;
+
+  // EFFECTS: Returns k distinct rows chosen uniformly at random, in
+  //          ascending order.  Returns every row if k >= num_rows().
+  std::vector<size_t> sample(size_t k, unsigned seed) const;
+
+private:
+  size_t row_stride;
+  size_t row_count;
+  uint64_t file_size;
+  int64_t file_mtime;
+  std::vector<uint64_t> offsets;
+
+  // Look up the size and modification time, in nanoseconds, of filename
+  static void stat_file(const std::string &filename,
+                        uint64_t &size, int64_t &mtime);
+};
+
+// Receives the tokens of one line, keeping every field
+class csv_all_fields {
+public:
+  csv_all_fields(std::vector<std::string> &data) : data(data) {
+    data.clear();
+  }
+  void new_field() { data.push_back(std::string()); }
+  void put(char c) { data.back() += c; }
+
+private:
+  std::vector<std::string> &data;
+};
+
+
+// Receives the tokens of one line, keeping only selected fields.  slots[i] is
+// the position of field i in data, or -1 if field i is discarded.  Counts
+// every field so that the caller can check the row length.
+class csv_selected_fields {
+public:
+  csv_selected_fields(std::vector<std::string> &data,
+                      const std::vector<int> &slots)
+    : data(data), slots(slots), current(nullptr), count(0) {
+    data.resize(num_selected(slots));
+    for (size_t i=0; i<data.size(); ++i) data[i].clear();
+  }
+  void new_field() {
+    current = nullptr;
+    if (count < slots.size() && slots[count] >= 0) {
+      current = &data[static_cast<size_t>(slots[count])];
+    }
+    ++count;
+  }
+  void put(char c) { if (current) current->push_back(c); }
+  size_t size() const { return count; }
+
+  static size_t num_selected(const std::vector<int> &slots) {
+    size_t n = 0;
+    for (size_t i=0; i<slots.size(); ++i) {
+      if (slots[i] >= 0) ++n;
+    }
+    return n;
+  }
+
+private:
+  std::vector<std::string> &data;
+  const std::vector<int> &slots;
+  std::string *current;
+  size_t count;
+};
+
+
+// Receives the tokens of one line and discards them, counting fields
+class csv_no_fields {
+public:
+  csv_no_fields() : count(0) {}
+  void new_field() { ++count; }
+  void put(char) {}
+  size_t size() const { return count; }
+
+private:
+  size_t count;
+};
+
+
+// Receives the tokens of one line, appending selected fields to the columns
+// of a csvbatch.  end_row() records where each field ends.
+class csv_batch_fields {
+public:
+  csv_batch_fields(csvbatch &batch, const std::vector<int> &slots)
+    : batch(batch), slots(slots), current(nullptr), count(0) {}
+  void new_field() {
+    current = nullptr;
+    if (count < slots.size() && slots[count] >= 0) {
+      current = &batch.columns[static_cast<size_t>(slots[count])].chars;
+    }
+    ++count;
+  }
+  void put(char c) { if (current) current->push_back(c); }
+  size_t size() const { return count; }
+
+  // Finish the current row and prepare for the next
+  void end_row() {
+    for (size_t i=0; i<batch.columns.size(); ++i) {
+      csvbatch::column_data &c = batch.columns[i];
+      c.offsets.push_back(c.chars.size());
+    }
+    ++batch.rows;
+    current = nullptr;
+    count = 0;
+  }
+
+  // Drop the characters of an unfinished row, leaving only whole rows
+  void discard_row() {
+    for (size_t i=0; i<batch.columns.size(); ++i) {
+      csvbatch::column_data &c = batch.columns[i];
+      c.chars.resize(c.offsets.back());
+    }
+    current = nullptr;
+    count = 0;
+  }
+
+private:
+  csvbatch &batch;
+  const std::vector<int> &slots;
+  std::string *current;
+  size_t count;
+};
+
+
+// Receives the tokens of one line read from a csv_buffer as views into the
+// buffer.  Fields are only copied, into copies, if removing quote characters
+// makes them discontiguous.
+class csv_field_views {
+public:
+  csv_field_views(std::vector<csvfield> &data, const std::vector<int> &slots,
+                  const csv_buffer &src, std::deque<std::string> &copies)
+    : data(data), slots(slots), src(src), copies(copies),
+      current(nullptr), copy(nullptr), count(0) {
+    data.assign(csv_selected_fields::num_selected(slots), csvfield());
+  }
+  void new_field() {
+    current = nullptr;
+    copy = nullptr;
+    if (count < slots.size() && slots[count] >= 0) {
+      current = &data[static_cast<size_t>(slots[count])];
+      *current = csvfield(src.pos(), 0);
+    }
+    ++count;
+  }
+  void put(char c) {
+    if (!current) return;
+    const char *p = src.pos() - 1;
+    if (current->size == 0 && !copy) current->data = p;
+    if (!copy && p == current->data + current->size) {
+      ++current->size;
+      return;
+    }
+    if (!copy) {
+      copies.push_back(current->str());
+      copy = &copies.back();
+    }
+    copy->push_back(c);
+    *current = csvfield(copy->data(), copy->size());
+  }
+  size_t size() const { return count; }
+
+private:
+  std::vector<csvfield> &data;
+  const std::vector<int> &slots;
+  const csv_buffer &src;
+  std::deque<std::string> &copies;
+  csvfield *current;
+  std::string *copy;
+  size_t count;
+};
+
+
+// Follows enough of read_csv_line()'s state machine to tell where records
+// begin, without tokenizing.  BEGIN is the state at the start of a record.
+class csv_record_scanner {
+public:
+  enum State {BEGIN, UNQUOTED, UNQUOTED_ESCAPED, QUOTED, QUOTED_ESCAPED, END,
+              NUM_STATES};
+
+  // The state reached at the end of a range, for each possible start state
+  struct transition {
+    State to[NUM_STATES];
+  };
+
+  static State next(State state, char c) {
+    switch (state) {
+    case END:
+      // A '\n' after a line ending is consumed with it, as in "\r\n" or
+      // "\n\n".  Anything else starts the next record.
+      if (c == '\n') return BEGIN;
+      #if __GNUG__ && __GNUC__ >= 7
+      [[fallthrough]];
+      #endif
+    case BEGIN:
+    case UNQUOTED:
+      if (c == '"') return QUOTED;
+      if (c == '\\') return UNQUOTED_ESCAPED;
+      // Like read_csv_line(), either character ends the record, and END
+      // consumes one '\n' after it
+      if (c == '\n' || c == '\r') return END;
+      return UNQUOTED;
+    case UNQUOTED_ESCAPED:
+      return UNQUOTED;
+    case QUOTED:
+      if (c == '"') return UNQUOTED;
+      if (c == '\\') return QUOTED_ESCAPED;
+      return QUOTED;
+    case QUOTED_ESCAPED:
+      return QUOTED;
+    default:
+      assert(0);
+      throw state;
+    }
+  }
+
+  // Speculatively scan [first, last) from every start state at once, since
+  // the true state at first is not known until earlier ranges are scanned.
+  static transition scan(const char *first, const char *last) {
+    const table &t = get_table();
+    unsigned char s[NUM_STATES];
+    for (int i=0; i<NUM_STATES; ++i) s[i] = static_cast<unsigned char>(i);
+    for (const char *p=first; p!=last; ++p) {
+      const unsigned char c = static_cast<unsigned char>(*p);
+      for (int i=0; i<NUM_STATES; ++i) s[i] = t.next[s[i]][c];
+    }
+    transition result;
+    for (int i=0; i<NUM_STATES; ++i) result.to[i] = static_cast<State>(s[i]);
+    return result;
+  }
+
+  // EFFECTS: Returns the start of the first record at or after first, given
+  //          the state at first, or last if no record starts before last.
+  //          A record starts after a line ending, which is a '\n' or '\r'
+  //          outside quotes together with one '\n' that follows it.
+  static const char * next_record(const char *first, const char *last,
+                                  State state) {
+    for (const char *p=first; p!=last; ++p) {
+      if (state == BEGIN || (state == END && *p != '\n')) return p;
+      state = next(state, *p);
+    }
+    return last;
+  }
+
+private:
+  struct table {
+    unsigned char next[NUM_STATES][256];
+  };
+
+  static const table & get_table() {
+    static const table t = make_table();
+    return t;
+  }
+
+  static table make_table() {
+    table t;
+    for (int s=0; s<NUM_STATES; ++s) {
+      for (int c=0; c<256; ++c) {
+        t.next[s][c] = static_cast<unsigned char>(
+          next(static_cast<State>(s), static_cast<char>(c)));
+      }
+    }
+    return t;
+  }
+};
+
+
+// Read and tokenize one line from a stream, handing each token to sink.
+// Source is std::istream or csv_buffer.
+template <typename Source, typename Sink>
+static bool read_csv_line(Source &is,
+                          Sink &sink,
                           char delimiter
                           ) {
 
   // Add entry for first token, start with empty string
-  data.clear();
-  data.push_back(std::string());
+  sink.new_field();
 
   // Process one character at a time
   char c = '\0';
-  enum State {BEGIN, QUOTED, QUOTED_ESCAPED, UNQUOTED, UNQUOTED_ESCAPED, END};
+  enum State {BEGIN, QUOTED, QUOTED_ESCAPED, QUOTED_CLOSED, UNQUOTED,
+              UNQUOTED_ESCAPED, END};
   State state = BEGIN;
   while(is.get(c)) {
     switch (state) {
+    case QUOTED_CLOSED:
+      // A double quote right after a closing one is a doubled quote inside
+      // the quoted token, as in RFC 4180.  Add one and reopen the quotes.
+      if (c == '"') {
+        sink.put(c);
+        state = QUOTED;
+        break;
+      }
+      state = UNQUOTED;
+      #if __GNUG__ && __GNUC__ >= 7
+      [[fallthrough]];
+      #endif
+
     case BEGIN:
       // We need this state transition to properly handle cases where nothing
       // is extracted.
@@ -114,11 +792,11 @@ static bool read_csv_line(std::istream &is,
         // Change states when we see a double quote
         state = QUOTED;
       } else if (c == '\\') { //note this checks for a single backslash char
+        // The backslash is dropped and the next character is kept
         state = UNQUOTED_ESCAPED;
-        data.back() += c;
       } else if (c == delimiter) {
         // If you see a delimiter, then start a new field with an empty string
-        data.push_back("");
+        sink.new_field();
       } else if (c == '\n' || c == '\r') {
         // If you see a line ending *and it's not within a quoted token*, stop
         // parsing the line.  Works for UNIX (\n) and OSX (\r) line endings.
@@ -126,32 +804,31 @@ static bool read_csv_line(std::istream &is,
         state = END;
       } else {
         // Append character to current token
-        data.back() += c;
+        sink.put(c);
       }
       break;
 
     case UNQUOTED_ESCAPED:
       // If a character is escaped, add it no matter what.
-      data.back() += c;
+      sink.put(c);
       state = UNQUOTED;
       break;
 
     case QUOTED:
       if (c == '"') {
-        // Change states when we see a double quote
-        state = UNQUOTED;
+        // Change states when we see a double quote, unless another follows
+        state = QUOTED_CLOSED;
       } else if (c == '\\') {
         state = QUOTED_ESCAPED;
-        data.back() += c;
       } else {
         // Append character to current token
-        data.back() += c;
+        sink.put(c);
       }
       break;
 
     case QUOTED_ESCAPED:
       // If a character is escaped, add it no matter what.
-      data.back() += c;
+      sink.put(c);
       state = QUOTED;
       break;
 
@@ -187,18 +864,17 @@ static bool read_csv_line(std::istream &is,
 }
 
 
+
 csvstream::csvstream(const std::string &filename, char delimiter, bool strict)
   : filename(filename),
     is(fin),
+    map_base(nullptr),
+    map_size(0),
+    ahead_eof(false),
     delimiter(delimiter),
     strict(strict),
     line_no(0) {
-
-  // Open file
-  fin.open(filename.c_str());
-  if (!fin.is_open()) {
-    throw csvstream_exception("Error opening file: " + filename);
-  }
+  open(filename);
 
   // Process header
   read_header();
@@ -208,6 +884,9 @@ csvstream::csvstream(const std::string &filename, char delimiter, bool strict)
 csvstream::csvstream(std::istream &is, char delimiter, bool strict)
   : filename("[no filename]"),
     is(is),
+    map_base(nullptr),
+    map_size(0),
+    ahead_eof(false),
     delimiter(delimiter),
     strict(strict),
     line_no(0) {
@@ -215,13 +894,86 @@ csvstream::csvstream(std::istream &is, char delimiter, bool strict)
 }
 
 
+csvstream::csvstream(const std::string &filename,
+                     const std::vector<std::string> &columns,
+                     char delimiter, bool strict)
+  : filename(filename),
+    is(fin),
+    map_base(nullptr),
+    map_size(0),
+    ahead_eof(false),
+    delimiter(delimiter),
+    strict(strict),
+    line_no(0),
+    columns(columns) {
+  open(filename);
+
+  // Process header
+  read_header();
+}
+
+
+csvstream::csvstream(std::istream &is,
+                     const std::vector<std::string> &columns,
+                     char delimiter, bool strict)
+  : filename("[no filename]"),
+    is(is),
+    map_base(nullptr),
+    map_size(0),
+    ahead_eof(false),
+    delimiter(delimiter),
+    strict(strict),
+    line_no(0),
+    columns(columns) {
+  read_header();
+}
+
+
 csvstream::~csvstream() {
+  stop_readahead();
+#ifdef CSVSTREAM_MMAP
+  if (map_base) munmap(const_cast<char *>(map_base), map_size);
+#endif
   if (fin.is_open()) fin.close();
 }
 
 
+void csvstream::open(const std::string &filename) {
+#ifdef CSVSTREAM_MMAP
+  // Map regular, non-empty files.  Pipes, terminals and the like fail the
+  // S_ISREG check and are read through ifstream below.
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    size_t size = static_cast<size_t>(st.st_size);
+    void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED) {
+      madvise(p, size, MADV_SEQUENTIAL);
+      map_base = static_cast<const char *>(p);
+      map_size = size;
+      buf = csv_buffer(map_base, map_base + map_size);
+    }
+  }
+  if (fd >= 0) close(fd);
+  if (map_base) return;
+#endif
+
+  // Open file
+  fin.open(filename.c_str());
+  if (!fin.is_open()) {
+    throw csvstream_exception("Error opening file: " + filename);
+  }
+}
+
+
 csvstream::operator bool() const {
-  return static_cast<bool>(is);
+  if (ahead) return !ahead_eof;
+  return map_base ? static_cast<bool>(buf) : static_cast<bool>(is);
+}
+
+
+bool csvstream::is_mapped() const {
+  return map_base != nullptr;
 }
 
 
@@ -230,35 +982,24 @@ std::vector<std::string> csvstream::getheader() const {
 }
 
 
+size_t csvstream::column_index(const std::string &name) const {
+  for (size_t i=0; i<columns.size(); ++i) {
+    if (columns[i] == name) return i;
+  }
+  throw csvstream_exception("Column not selected: " + name);
+}
+
+
 csvstream & csvstream::operator>> (std::map<std::string, std::string>& row) {
   // Clear input row
   row.clear();
 
   // Read one line from stream, bail out if we're at the end
-  std::vector<std::string> data;
-  if (!read_csv_line(is, data, delimiter)) return *this;
-  line_no += 1;
-
-  // When strict mode is disabled, coerce the length of the data.  If data is
-  // larger than header, discard extra values.  If data is smaller than header,
-  // pad data with empty strings.
-  if (!strict) {
-    data.resize(header.size());
-  }
-
-  // Check length of data
-  if (data.size() != header.size()) {
-    auto msg = "Number of items in row does not match header. " +
-      filename + ":L" + std::to_string(line_no) + " " +
-      "header.size() = " + std::to_string(header.size()) + " " +
-      "row.size() = " + std::to_string(data.size()) + " "
-      ;
-    throw csvstream_exception(msg);
-  }
+  if (!read_row(fields)) return *this;
 
   // combine data and header into a row object
-  for (size_t i=0; i<data.size(); ++i) {
-    row[header[i]] = data[i];
+  for (size_t i=0; i<fields.size(); ++i) {
+    row[columns[i]] = fields[i];
   }
 
   return *this;
@@ -268,44 +1009,545 @@ csvstream & csvstream::operator>> (std::map<std::string, std::string>& row) {
 csvstream & csvstream::operator>> (std::vector<std::pair<std::string, std::string> >& row) {
   // Clear input row
   row.clear();
-  row.resize(header.size());
 
   // Read one line from stream, bail out if we're at the end
-  std::vector<std::string> data;
-  if (!read_csv_line(is, data, delimiter)) return *this;
+  if (!read_row(fields)) return *this;
+
+  // combine data and header into a row object
+  row.resize(fields.size());
+  for (size_t i=0; i<fields.size(); ++i) {
+    row[i] = make_pair(columns[i], fields[i]);
+  }
+
+  return *this;
+}
+
+
+csvstream & csvstream::operator>> (std::vector<std::string>& row) {
+  if (!read_row(row)) row.clear();
+  return *this;
+}
+
+
+csvstream & csvstream::operator>> (std::vector<csvfield>& row) {
+  row.clear();
+
+  // Without a mapping, view the fields of a copied row
+  if (!map_base || ahead) {
+    if (!read_row(fields)) return *this;
+    for (size_t i=0; i<fields.size(); ++i) {
+      row.push_back(csvfield(fields[i].data(), fields[i].size()));
+    }
+    return *this;
+  }
+
+  csv_field_views sink(row, column_slots, buf, field_copies);
+  if (!read_csv_line(buf, sink, delimiter)) {
+    row.clear();
+    return *this;
+  }
   line_no += 1;
+  check_row_length(sink.size());
+  return *this;
+}
+
 
-  // When strict mode is disabled, coerce the length of the data.  If data is
-  // larger than header, discard extra values.  If data is smaller than header,
-  // pad data with empty strings.
-  if (!strict) {
-    data.resize(header.size());
+size_t csvstream::read_batch(csvbatch &batch, size_t max_rows) {
+  check_not_ahead("read_batch");
+  batch.clear(columns.size());
+  csv_batch_fields sink(batch, column_slots);
+  while (batch.num_rows() < max_rows) {
+    try {
+      if (!read_line(sink)) break;
+      line_no += 1;
+      check_row_length(sink.size());
+    }
+    catch (...) {
+      sink.discard_row();
+      throw;
+    }
+    sink.end_row();
   }
+  return batch.num_rows();
+}
+
+
+bool csvstream::read_row(std::vector<std::string> &data) {
+  if (ahead) return pop_row(data);
+  return parse_row(data);
+}
 
-  // Check length of data
-  if (row.size() != header.size()) {
+
+bool csvstream::parse_row(std::vector<std::string> &data) {
+  // Read one line from stream, bail out if we're at the end
+  csv_selected_fields sink(data, column_slots);
+  if (!read_line(sink)) return false;
+  line_no += 1;
+  check_row_length(sink.size());
+  return true;
+}
+
+
+template <typename Sink>
+bool csvstream::read_line(Sink &sink) {
+  if (map_base) return read_csv_line(buf, sink, delimiter);
+  return read_csv_line(is, sink, delimiter);
+}
+
+
+void csvstream::check_row_length(size_t n) const {
+  // When strict mode is disabled, extra values are discarded and missing
+  // values are left as empty strings.  Otherwise, check length of data.
+  if (strict && n != header.size()) {
     auto msg = "Number of items in row does not match header. " +
       filename + ":L" + std::to_string(line_no) + " " +
       "header.size() = " + std::to_string(header.size()) + " " +
-      "row.size() = " + std::to_string(row.size()) + " "
+      "row.size() = " + std::to_string(n) + " "
       ;
     throw csvstream_exception(msg);
   }
+}
 
-  // combine data and header into a row object
-  for (size_t i=0; i<data.size(); ++i) {
-    row[i] = make_pair(header[i], data[i]);
+
+size_t csvstream::num_chunks(unsigned num_threads) const {
+  // Chunks smaller than this cost more in thread startup than they save
+  const size_t min_chunk_size = 1 << 16;
+  if (num_threads == 0) num_threads = std::thread::hardware_concurrency();
+  if (num_threads == 0) num_threads = 1;
+  size_t remaining = static_cast<size_t>(map_base + map_size - buf.pos());
+  return std::min<size_t>(num_threads, remaining / min_chunk_size + 1);
+}
+
+
+void csvstream::parse_chunks(
+    size_t n, const std::function<void(size_t, rows_type &)> &deliver) {
+  typedef csv_record_scanner scanner;
+  const char *first = buf.pos();
+  const char *last = map_base + map_size;
+  std::vector<std::thread> workers;
+
+  // Split the rest of the buffer into n equal byte ranges
+  std::vector<const char *> splits(n + 1);
+  for (size_t i=0; i<=n; ++i) {
+    splits[i] = first + static_cast<size_t>(last - first) / n * i;
   }
+  splits[n] = last;
 
-  return *this;
+  // Pass 1: for every range in parallel, the end state for each start state
+  std::vector<scanner::transition> transitions(n);
+  for (size_t i=0; i<n; ++i) {
+    workers.push_back(std::thread([&, i]() {
+      transitions[i] = scanner::scan(splits[i], splits[i + 1]);
+    }));
+  }
+  for (size_t i=0; i<n; ++i) workers[i].join();
+  workers.clear();
+
+  // Chain the transitions from the known state at first, then move each split
+  // forward to the start of the next record
+  std::vector<const char *> starts(splits);
+  scanner::State state = scanner::BEGIN;
+  for (size_t i=1; i<n; ++i) {
+    state = transitions[i - 1].to[state];
+    starts[i] = scanner::next_record(splits[i], last, state);
+  }
+
+  // Pass 2: tokenize each range of whole records in parallel.  A row length
+  // mismatch stops its chunk and is reported below, with its line number.
+  std::vector<size_t> num_rows(n, 0);
+  std::vector<size_t> bad_length(n, 0);
+  std::vector<char> bad(n, false);
+  std::vector<std::exception_ptr> errors(n);
+  for (size_t i=0; i<n; ++i) {
+    workers.push_back(std::thread([&, i]() {
+      try {
+        csv_buffer chunk(starts[i], starts[i + 1]);
+        rows_type rows;
+        std::vector<std::string> row;
+        for (;;) {
+          csv_selected_fields sink(row, column_slots);
+          if (!read_csv_line(chunk, sink, delimiter)) break;
+          if (strict && sink.size() != header.size()) {
+            bad[i] = true;
+            bad_length[i] = sink.size();
+            break;
+          }
+          rows.push_back(std::move(row));
+        }
+        num_rows[i] = rows.size();
+        if (!bad[i]) deliver(i, rows);
+      }
+      catch (...) {
+        errors[i] = std::current_exception();
+      }
+    }));
+  }
+  for (size_t i=0; i<n; ++i) workers[i].join();
+
+  // The buffer is now exhausted
+  buf = csv_buffer(last, last);
+  for (size_t i=0; i<n; ++i) {
+    line_no += num_rows[i];
+    if (bad[i]) {
+      line_no += 1;
+      check_row_length(bad_length[i]);
+    }
+    if (errors[i]) std::rethrow_exception(errors[i]);
+  }
+}
+
+
+csvstream::rows_type csvstream::read_all(unsigned num_threads) {
+  rows_type rows;
+  if (!map_base || ahead) {
+    std::vector<std::string> row;
+    while (read_row(row)) rows.push_back(row);
+    return rows;
+  }
+
+  std::vector<rows_type> parts(num_chunks(num_threads));
+  parse_chunks(parts.size(), [&parts](size_t i, rows_type &part) {
+    parts[i].swap(part);
+  });
+
+  size_t total = 0;
+  for (size_t i=0; i<parts.size(); ++i) total += parts[i].size();
+  rows.reserve(total);
+  for (size_t i=0; i<parts.size(); ++i) {
+    for (size_t j=0; j<parts[i].size(); ++j) {
+      rows.push_back(std::move(parts[i][j]));
+    }
+  }
+  return rows;
+}
+
+
+void csvstream::read_all_unordered(unsigned num_threads,
+                                   const std::function<void(rows_type &)> &fn) {
+  if (!map_base || ahead) {
+    rows_type rows = read_all(1);
+    fn(rows);
+    return;
+  }
+  parse_chunks(num_chunks(num_threads), [&fn](size_t, rows_type &part) {
+    fn(part);
+  });
+}
+
+
+void csvstream::start_readahead(size_t capacity) {
+  if (ahead) return;
+  ahead.reset(new csv_readahead(capacity));
+  ahead->thread = std::thread(&csvstream::produce_rows, this);
+}
+
+
+// Wake the thread waiting on cv if its flag says it may be asleep.  Called
+// after the caller's own update, which the fence orders before the check.
+static void csv_wake(csv_readahead &ahead, std::atomic<bool> &waiting,
+                     std::condition_variable &cv) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiting.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(ahead.mutex);
+    cv.notify_one();
+  }
+}
+
+
+void csvstream::produce_rows() {
+  try {
+    std::vector<std::string> row;
+    while (!ahead->stop.load(std::memory_order_relaxed) && parse_row(row)) {
+      if (!ahead->rows.push(row)) {
+        // Sleep until the consumer makes room
+        std::unique_lock<std::mutex> lock(ahead->mutex);
+        ahead->producer_waiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (!ahead->rows.push(row)) {
+          if (ahead->stop.load(std::memory_order_relaxed)) return;
+          ahead->room.wait(lock);
+        }
+        ahead->producer_waiting.store(false, std::memory_order_relaxed);
+      }
+      csv_wake(*ahead, ahead->consumer_waiting, ahead->ready);
+    }
+  }
+  catch (...) {
+    ahead->error = std::current_exception();
+  }
+  ahead->done.store(true, std::memory_order_release);
+  csv_wake(*ahead, ahead->consumer_waiting, ahead->ready);
+}
+
+
+bool csvstream::pop_row(std::vector<std::string> &data) {
+  if (!ahead->rows.pop(data)) {
+    // Sleep until the producer pushes a row or finishes
+    std::unique_lock<std::mutex> lock(ahead->mutex);
+    ahead->consumer_waiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (!ahead->rows.pop(data)) {
+      if (ahead->done.load(std::memory_order_acquire)) {
+        // The producer may have pushed more rows before finishing
+        ahead->consumer_waiting.store(false, std::memory_order_relaxed);
+        if (ahead->rows.pop(data)) return true;
+        ahead_eof = true;
+        if (ahead->error) {
+          std::exception_ptr error = ahead->error;
+          ahead->error = nullptr;
+          std::rethrow_exception(error);
+        }
+        return false;
+      }
+      ahead->ready.wait(lock);
+    }
+    ahead->consumer_waiting.store(false, std::memory_order_relaxed);
+  }
+  csv_wake(*ahead, ahead->producer_waiting, ahead->room);
+  return true;
+}
+
+
+void csvstream::stop_readahead() {
+  if (!ahead) return;
+  ahead->stop.store(true, std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> lock(ahead->mutex);
+    ahead->room.notify_one();
+  }
+  if (ahead->thread.joinable()) ahead->thread.join();
+}
+
+
+void csvstream::check_not_ahead(const char *operation) const {
+  if (ahead) {
+    throw csvstream_exception(std::string(operation) +
+                              " while reading ahead: " + filename);
+  }
+}
+
+
+uint64_t csvstream::tell() {
+  if (map_base) return static_cast<uint64_t>(buf.pos() - map_base);
+  return static_cast<uint64_t>(is.tellg());
+}
+
+
+bool csvstream::skip_row() {
+  check_not_ahead("skip_row");
+  csv_no_fields sink;
+  if (!read_line(sink)) return false;
+  line_no += 1;
+  return true;
+}
+
+
+void csvstream::seek_row(const csvindex &index, size_t row) {
+  check_not_ahead("seek_row");
+  if (row >= index.num_rows()) {
+    throw csvstream_exception("Row out of range for index: " +
+                              std::to_string(row) + " " + filename);
+  }
+
+  uint64_t offset = index.checkpoint(row);
+  if (map_base) {
+    if (offset > map_size) {
+      throw csvstream_exception("Index does not match file: " + filename);
+    }
+    buf = csv_buffer(map_base + offset, map_base + map_size);
+  }
+  else {
+    is.clear();
+    is.seekg(static_cast<std::streamoff>(offset));
+    if (!is) throw csvstream_exception("Cannot seek in stream: " + filename);
+  }
+
+  // Skip from the checkpoint to the requested row
+  line_no = row - row % index.stride();
+  while (line_no < row && skip_row()) {}
+}
+
+
+csvindex csvindex::build(const std::string &filename, size_t stride) {
+  assert(stride > 0);
+  csvindex index;
+  index.row_stride = stride;
+  stat_file(filename, index.file_size, index.file_mtime);
+
+  csvstream csvin(filename);
+  for (;;) {
+    uint64_t offset = csvin.tell();
+    if (!csvin.skip_row()) break;
+    if (index.row_count % stride == 0) index.offsets.push_back(offset);
+    ++index.row_count;
+  }
+  return index;
+}
+
+
+csvindex csvindex::load(const std::string &filename,
+                        const std::string &index_filename) {
+  std::ifstream fin(index_filename.c_str(), std::ios::binary);
+  if (!fin.is_open()) {
+    throw csvstream_exception("Error opening file: " + index_filename);
+  }
+
+  char magic[8];
+  uint64_t stride = 0;
+  uint64_t rows = 0;
+  csvindex index;
+  fin.read(magic, sizeof(magic));
+  fin.read(reinterpret_cast<char *>(&stride), sizeof(stride));
+  fin.read(reinterpret_cast<char *>(&rows), sizeof(rows));
+  fin.read(reinterpret_cast<char *>(&index.file_size), sizeof(index.file_size));
+  fin.read(reinterpret_cast<char *>(&index.file_mtime),
+           sizeof(index.file_mtime));
+  if (!fin || std::string(magic, sizeof(magic)) != std::string("CSVIDX2", 8) ||
+      stride == 0) {
+    throw csvstream_exception("Corrupt index: " + index_filename);
+  }
+
+  // Check the header against the file before trusting its sizes.  Every
+  // row takes at least one byte, which bounds the number of offsets.
+  uint64_t size = 0;
+  int64_t mtime = 0;
+  stat_file(filename, size, mtime);
+  if (size != index.file_size || mtime != index.file_mtime) {
+    throw csvstream_exception("Stale index: " + index_filename);
+  }
+  if (rows > size) {
+    throw csvstream_exception("Corrupt index: " + index_filename);
+  }
+  index.row_stride = static_cast<size_t>(stride);
+  index.row_count = static_cast<size_t>(rows);
+  index.offsets.resize(rows / stride + (rows % stride != 0 ? 1 : 0));
+  const size_t bytes = index.offsets.size() * sizeof(uint64_t);
+  fin.read(reinterpret_cast<char *>(index.offsets.data()),
+           static_cast<std::streamsize>(bytes));
+  if (!fin) throw csvstream_exception("Corrupt index: " + index_filename);
+  return index;
+}
+
+
+csvindex csvindex::open(const std::string &filename, size_t stride) {
+  const std::string index_filename = filename + ".idx";
+  try {
+    csvindex index = load(filename, index_filename);
+    if (index.stride() == stride) return index;
+  }
+  catch (const csvstream_exception &) {
+    // Missing, corrupt or stale, so rebuild it below
+  }
+  csvindex index = build(filename, stride);
+  try {
+    index.save(index_filename);
+  }
+  catch (const csvstream_exception &) {
+    // The directory may be read-only; the index works without being saved
+  }
+  return index;
+}
+
+
+void csvindex::save(const std::string &index_filename) const {
+  std::ofstream fout(index_filename.c_str(), std::ios::binary);
+  uint64_t stride = row_stride;
+  uint64_t rows = row_count;
+  fout.write("CSVIDX2", 8);
+  fout.write(reinterpret_cast<const char *>(&stride), sizeof(stride));
+  fout.write(reinterpret_cast<const char *>(&rows), sizeof(rows));
+  fout.write(reinterpret_cast<const char *>(&file_size), sizeof(file_size));
+  fout.write(reinterpret_cast<const char *>(&file_mtime), sizeof(file_mtime));
+  fout.write(reinterpret_cast<const char *>(offsets.data()),
+             static_cast<std::streamsize>(offsets.size() * sizeof(uint64_t)));
+  if (!fout) throw csvstream_exception("Error writing file: " + index_filename);
+}
+
+
+std::vector<std::pair<size_t, size_t> > csvindex::split(size_t n) const {
+  assert(n > 0);
+  std::vector<std::pair<size_t, size_t> > ranges;
+  size_t first = 0;
+  for (size_t i=0; i<n; ++i) {
+    size_t last = first + row_count / n + (i < row_count % n ? 1 : 0);
+    ranges.push_back(std::make_pair(first, last));
+    first = last;
+  }
+  return ranges;
+}
+
+
+std::vector<size_t> csvindex::sample(size_t k, unsigned seed) const {
+  // Floyd's algorithm picks k distinct rows with k random draws
+  std::mt19937 gen(seed);
+  std::set<size_t> rows;
+  k = std::min(k, row_count);
+  for (size_t j=row_count - k; j<row_count; ++j) {
+    size_t t = std::uniform_int_distribution<size_t>(0, j)(gen);
+    if (!rows.insert(t).second) rows.insert(j);
+  }
+  return std::vector<size_t>(rows.begin(), rows.end());
+}
+
+
+void csvindex::stat_file(const std::string &filename,
+                         uint64_t &size, int64_t &mtime) {
+  size = 0;
+  mtime = 0;
+#ifdef CSVSTREAM_MMAP
+  struct stat st;
+  if (stat(filename.c_str(), &st) != 0) {
+    throw csvstream_exception("Error opening file: " + filename);
+  }
+  size = static_cast<uint64_t>(st.st_size);
+  // Nanoseconds, so a file rewritten within a second still looks changed
+#ifdef __APPLE__
+  const struct timespec &modified = st.st_mtimespec;
+#else
+  const struct timespec &modified = st.st_mtim;
+#endif
+  mtime = static_cast<int64_t>(modified.tv_sec) * 1000000000 +
+          static_cast<int64_t>(modified.tv_nsec);
+#else
+  std::ifstream fin(filename.c_str(), std::ios::binary | std::ios::ate);
+  if (!fin.is_open()) {
+    throw csvstream_exception("Error opening file: " + filename);
+  }
+  size = static_cast<uint64_t>(fin.tellg());
+#endif
 }
 
 
 void csvstream::read_header() {
   // read first line, which is the header
-  if (!read_csv_line(is, header, delimiter)) {
+  csv_all_fields sink(header);
+  if (!read_line(sink)) {
     throw csvstream_exception("error reading header");
   }
+
+  // With no explicit selection, every column is kept in header order
+  column_slots.assign(header.size(), -1);
+  if (columns.empty()) {
+    columns = header;
+    for (size_t j=0; j<header.size(); ++j) {
+      column_slots[j] = static_cast<int>(j);
+    }
+    return;
+  }
+
+  // Resolve each selected column name to its position in the header
+  for (size_t i=0; i<columns.size(); ++i) {
+    size_t j = 0;
+    while (j < header.size() && header[j] != columns[i]) ++j;
+    if (j == header.size()) {
+      throw csvstream_exception("Column not found in header: " + columns[i]);
+    }
+    // Each header column fills at most one selected position
+    if (column_slots[j] >= 0) {
+      throw csvstream_exception("Column selected twice: " + columns[i]);
+    }
+    column_slots[j] = static_cast<int>(i);
+  }
 }
 
 #endif
@@ -0,0 +1,509 @@
+//
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "csvstream.h"
+#include "unit_test_framework.h"
+
+using namespace std;
+
+TEST(test_select_columns) {
+    istringstream fin("n,tag,content,author\n"
+                      "1,euchre,my code segfaults,bob\n"
+                      "2,exam,\"when, where\",alice\n");
+    csvstream csvin(fin, {"content", "tag"});
+    ASSERT_EQUAL(csvin.column_index("content"), 0);
+    ASSERT_EQUAL(csvin.column_index("tag"), 1);
+
+    vector<string> row;
+    ASSERT_TRUE(bool(csvin >> row));
+    ASSERT_EQUAL(row.size(), 2);
+    ASSERT_EQUAL(row[0], "my code segfaults");
+    ASSERT_EQUAL(row[1], "euchre");
+    ASSERT_TRUE(bool(csvin >> row));
+    ASSERT_EQUAL(row[0], "when, where");
+    ASSERT_EQUAL(row[1], "exam");
+    ASSERT_FALSE(bool(csvin >> row));
+}
+
+TEST(test_select_columns_map) {
+    istringstream fin("n,tag,content\n1,euchre,bob is the dealer\n");
+    csvstream csvin(fin, {"tag"});
+    map<string, string> row;
+    ASSERT_TRUE(bool(csvin >> row));
+    ASSERT_EQUAL(row.size(), 1);
+    ASSERT_EQUAL(row["tag"], "euchre");
+}
+
+TEST(test_quotes_and_escapes) {
+    istringstream fin("a,b,c\n"
+                      "\"say \"\"pass\"\"\",x\\,y,\"\"\n"
+                      "\"C:\\\\tmp\",\"\\\"\",z\n");
+    csvstream csvin(fin);
+    vector<string> row;
+    ASSERT_TRUE(bool(csvin >> row));
+    ASSERT_EQUAL(row[0], "say \"pass\"");
+    ASSERT_EQUAL(row[1], "x,y");
+    ASSERT_EQUAL(row[2], "");
+    ASSERT_TRUE(bool(csvin >> row));
+    ASSERT_EQUAL(row[0], "C:\\tmp");
+    ASSERT_EQUAL(row[1], "\"");
+    ASSERT_EQUAL(row[2], "z");
+}
+
+TEST(test_select_columns_twice) {
+    istringstream fin("n,tag,content\n1,euchre,bob is the dealer\n");
+    bool thrown = false;
+    try {
+        csvstream csvin(fin, {"tag", "tag"});
+    }
+    catch (const csvstream_exception &e) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown);
+}
+
+TEST(test_all_columns_index) {
+    istringstream fin("a,b,c\n1,2,3\n");
+    csvstream csvin(fin);
+    ASSERT_EQUAL(csvin.column_index("c"), 2);
+    vector<string> row;
+    ASSERT_TRUE(bool(csvin >> row));
+    ASSERT_EQUAL(row, vector<string>({"1", "2", "3"}));
+}
+
+TEST(test_missing_column) {
+    istringstream fin("a,b\n1,2\n");
+    bool thrown = false;
+    try {
+        csvstream csvin(fin, {"a", "z"});
+    }
+    catch (const csvstream_exception &e) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown);
+}
+
+TEST(test_strict_row_length) {
+    istringstream fin("a,b\n1,2,3\n");
+    csvstream csvin(fin, {"b"});
+    vector<string> row;
+    bool thrown = false;
+    try {
+        csvin >> row;
+    }
+    catch (const csvstream_exception &e) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown);
+}
+
+TEST(test_not_strict_row_length) {
+    istringstream fin("a,b,c\n1\n");
+    csvstream csvin(fin, {"c", "a"}, ',', false);
+    vector<string> row;
+    ASSERT_TRUE(bool(csvin >> row));
+    ASSERT_EQUAL(row, vector<string>({"", "1"}));
+}
+
+TEST(test_mapped_file) {
+    csvstream csvin("test_small.csv", {"tag", "content"});
+#ifdef CSVSTREAM_MMAP
+    ASSERT_TRUE(csvin.is_mapped());
+#endif
+    vector<string> row;
+    ASSERT_TRUE(bool(csvin >> row));
+    ASSERT_EQUAL(row[0], "euchre");
+    ASSERT_EQUAL(row[1], "my code segfaults when bob is the dealer");
+}
+
+TEST(test_mapped_views) {
+    const char *filename = "csvstream_tests.tmp.csv";
+    {
+        ofstream fout(filename);
+        fout << "tag,content\n"
+             << "euchre,\"quoted\"\n"
+             << "exam,half\"quoted\"\n";
+    }
+    vector<csvfield> first;
+    vector<csvfield> second;
+    {
+        csvstream csvin(filename);
+        ASSERT_TRUE(bool(csvin >> first));
+        ASSERT_TRUE(bool(csvin >> second));
+        // Views of a mapped file outlive the next read
+        ASSERT_TRUE(first[0] == "euchre");
+        ASSERT_TRUE(first[1] == "quoted");
+        ASSERT_TRUE(second[0] == "exam");
+        ASSERT_TRUE(second[1] == "halfquoted");
+        vector<csvfield> row;
+        ASSERT_FALSE(bool(csvin >> row));
+        ASSERT_TRUE(row.empty());
+    }
+    remove(filename);
+}
+
+TEST(test_stream_views) {
+    istringstream fin("a,b\n1,\"x,y\"\n");
+    csvstream csvin(fin);
+    ASSERT_FALSE(csvin.is_mapped());
+    vector<csvfield> row;
+    ASSERT_TRUE(bool(csvin >> row));
+    ASSERT_EQUAL(row.size(), 2);
+    ASSERT_EQUAL(row[0].str(), "1");
+    ASSERT_EQUAL(row[1].str(), "x,y");
+}
+
+TEST(test_read_batch) {
+    istringstream fin("n,tag,content\n"
+                      "1,euchre,bob is the dealer\n"
+                      "2,exam,\"when, where\"\n"
+                      "3,calculator,\n");
+    csvstream csvin(fin, {"tag", "content"});
+    csvbatch batch;
+    ASSERT_EQUAL(csvin.read_batch(batch, 2), 2);
+    ASSERT_EQUAL(batch.num_columns(), 2);
+    ASSERT_EQUAL(batch.chars(0), "euchreexam");
+    ASSERT_EQUAL(batch.offsets(0), vector<size_t>({0, 6, 10}));
+    ASSERT_TRUE(batch.field(1, 1) == "when, where");
+
+    ASSERT_EQUAL(csvin.read_batch(batch, 2), 1);
+    ASSERT_EQUAL(batch.num_rows(), 1);
+    ASSERT_TRUE(batch.field(0, 0) == "calculator");
+    ASSERT_TRUE(batch.field(1, 0) == "");
+
+    ASSERT_EQUAL(csvin.read_batch(batch, 2), 0);
+    ASSERT_EQUAL(batch.num_rows(), 0);
+}
+
+TEST(test_read_batch_bad_row) {
+    istringstream fin("n,tag,content\n"
+                      "1,euchre,bob is the dealer\n"
+                      "2,exam,when,where\n");
+    csvstream csvin(fin, {"tag", "content"});
+    csvbatch batch;
+    bool thrown = false;
+    try {
+        csvin.read_batch(batch, 10);
+    }
+    catch (const csvstream_exception &e) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown);
+    // The batch holds only the whole row before the bad one
+    ASSERT_EQUAL(batch.num_rows(), 1);
+    ASSERT_EQUAL(batch.chars(0), "euchre");
+    ASSERT_EQUAL(batch.chars(1), "bob is the dealer");
+}
+
+TEST(test_index_seek) {
+    csvindex index = csvindex::build("train_small.csv", 3);
+    ASSERT_EQUAL(index.num_rows(), 8);
+    ASSERT_EQUAL(index.stride(), 3);
+
+    vector<string> expected;
+    {
+        csvstream csvin("train_small.csv", {"content"});
+        vector<string> row;
+        while (csvin >> row) {
+            expected.push_back(row[0]);
+        }
+    }
+
+    csvstream csvin("train_small.csv", {"content"});
+    vector<string> row;
+    for (size_t i : {5, 0, 4, 3, 7}) {
+        csvin.seek_row(index, i);
+        ASSERT_TRUE(bool(csvin >> row));
+        ASSERT_EQUAL(row[0], expected[i]);
+    }
+    ASSERT_FALSE(bool(csvin >> row));
+}
+
+TEST(test_index_stream_seek) {
+    csvindex index = csvindex::build("train_small.csv");
+    ifstream fin("train_small.csv");
+    csvstream csvin(fin, {"tag"});
+    vector<string> row;
+    csvin.seek_row(index, 6);
+    ASSERT_TRUE(bool(csvin >> row));
+    ASSERT_TRUE(bool(csvin >> row));
+    ASSERT_FALSE(bool(csvin >> row));
+}
+
+TEST(test_index_save_load) {
+    const char *index_filename = "train_small.csv.idx";
+    csvindex built = csvindex::open("train_small.csv", 2);
+    csvindex loaded = csvindex::load("train_small.csv", index_filename);
+    ASSERT_EQUAL(loaded.num_rows(), built.num_rows());
+    ASSERT_EQUAL(loaded.stride(), 2);
+    for (size_t i = 0; i < built.num_rows(); ++i) {
+        ASSERT_EQUAL(loaded.checkpoint(i), built.checkpoint(i));
+    }
+    remove(index_filename);
+}
+
+TEST(test_index_corrupt_rebuilt) {
+    const char *index_filename = "train_small.csv.idx";
+    csvindex built = csvindex::open("train_small.csv", 2);
+    {
+        // Overwrite the row count with a huge number
+        fstream index_file(index_filename,
+                           ios::in | ios::out | ios::binary);
+        uint64_t rows = uint64_t(1) << 60;
+        index_file.seekp(16);
+        index_file.write(reinterpret_cast<const char *>(&rows), sizeof(rows));
+    }
+    bool thrown = false;
+    try {
+        csvindex::load("train_small.csv", index_filename);
+    }
+    catch (const csvstream_exception &e) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown);
+
+    csvindex rebuilt = csvindex::open("train_small.csv", 2);
+    ASSERT_EQUAL(rebuilt.num_rows(), built.num_rows());
+    remove(index_filename);
+}
+
+TEST(test_index_not_saved) {
+    // A directory where the index would go makes saving it fail
+    const char *index_filename = "train_small.csv.idx";
+    ASSERT_EQUAL(mkdir(index_filename, 0755), 0);
+    csvindex index = csvindex::open("train_small.csv", 2);
+    rmdir(index_filename);
+    ASSERT_EQUAL(index.num_rows(),
+                 csvindex::build("train_small.csv").num_rows());
+}
+
+TEST(test_index_split_sample) {
+    csvindex index = csvindex::build("train_small.csv");
+    vector<pair<size_t, size_t>> ranges = index.split(3);
+    ASSERT_EQUAL(ranges.size(), 3);
+    ASSERT_EQUAL(ranges[0], make_pair(size_t(0), size_t(3)));
+    ASSERT_EQUAL(ranges[1], make_pair(size_t(3), size_t(6)));
+    ASSERT_EQUAL(ranges[2], make_pair(size_t(6), size_t(8)));
+
+    vector<size_t> rows = index.sample(5, 280);
+    ASSERT_EQUAL(rows.size(), 5);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        ASSERT_TRUE(rows[i] < 8);
+        ASSERT_TRUE(i == 0 || rows[i - 1] < rows[i]);
+    }
+    ASSERT_EQUAL(index.sample(20, 280).size(), 8);
+}
+
+TEST(test_readahead) {
+    vector<vector<string>> expected;
+    {
+        csvstream csvin("w16_projects_exam.csv");
+        vector<string> row;
+        while (csvin >> row) {
+            expected.push_back(row);
+        }
+    }
+
+    csvstream csvin("w16_projects_exam.csv");
+    csvin.start_readahead(16);
+    vector<vector<string>> actual;
+    map<string, string> first;
+    ASSERT_TRUE(bool(csvin >> first));
+    ASSERT_EQUAL(first["tag"], expected[0][0]);
+    vector<string> row;
+    while (csvin >> row) {
+        actual.push_back(row);
+    }
+    ASSERT_EQUAL(actual.size() + 1, expected.size());
+    ASSERT_TRUE(equal(actual.begin(), actual.end(), expected.begin() + 1));
+    ASSERT_FALSE(bool(csvin >> row));
+}
+
+TEST(test_readahead_slow_consumer) {
+    // The producer fills the queue and sleeps until rows are taken
+    csvstream csvin("w16_projects_exam.csv");
+    csvin.start_readahead(2);
+    vector<string> row;
+    size_t count = 0;
+    while (csvin >> row) {
+        if (count++ % 100 == 0) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    }
+    csvstream csvin2("w16_projects_exam.csv");
+    size_t expected = 0;
+    while (csvin2 >> row) {
+        ++expected;
+    }
+    ASSERT_EQUAL(count, expected);
+
+    // Reading ahead excludes batch reads and seeks
+    csvbatch batch;
+    bool thrown = false;
+    try {
+        csvin.read_batch(batch, 10);
+    }
+    catch (const csvstream_exception &e) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown);
+}
+
+TEST(test_readahead_error) {
+    istringstream fin("a,b\n1,2\n3,4\n5\n6,7\n");
+    csvstream csvin(fin);
+    csvin.start_readahead(1);
+    vector<string> row;
+    ASSERT_TRUE(bool(csvin >> row));
+    ASSERT_TRUE(bool(csvin >> row));
+    ASSERT_EQUAL(row[0], "3");
+    bool thrown = false;
+    try {
+        csvin >> row;
+    }
+    catch (const csvstream_exception &e) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown);
+    ASSERT_FALSE(bool(csvin >> row));
+}
+
+TEST(test_readahead_early_exit) {
+    // The producer is waiting on a full queue when the stream is destroyed
+    csvstream csvin("w16_projects_exam.csv");
+    csvin.start_readahead(2);
+    vector<string> row;
+    ASSERT_TRUE(bool(csvin >> row));
+}
+
+TEST(test_read_all_parallel) {
+    // Large enough to be split, with line endings inside quoted fields
+    const char *filename = "csvstream_tests.tmp.csv";
+    {
+        ofstream fout(filename);
+        fout << "n,tag,content\n";
+        for (int i = 0; i < 20000; ++i) {
+            fout << i << ",tag" << i % 7 << ",";
+            if (i % 3 == 0) {
+                fout << "\"a \\\" quoted\nfield, " << i << "\"";
+            }
+            else {
+                fout << "plain field " << i;
+            }
+            fout << (i % 5 == 0 ? "\r\n" : "\n");
+        }
+    }
+
+    vector<vector<string>> expected;
+    {
+        csvstream csvin(filename, {"content", "n"});
+        vector<string> row;
+        while (csvin >> row) {
+            expected.push_back(row);
+        }
+    }
+    ASSERT_EQUAL(expected.size(), 20000);
+
+    csvstream csvin(filename, {"content", "n"});
+    csvstream::rows_type rows = csvin.read_all(4);
+    ASSERT_TRUE(rows == expected);
+    vector<string> row;
+    ASSERT_FALSE(bool(csvin >> row));
+
+    csvstream csvin2(filename, {"content", "n"});
+    size_t total = 0;
+    csvin2.read_all_unordered(4, [&total](csvstream::rows_type &batch) {
+        static std::mutex m;
+        std::lock_guard<std::mutex> lock(m);
+        total += batch.size();
+    });
+    ASSERT_EQUAL(total, 20000);
+    remove(filename);
+}
+
+TEST(test_read_all_unordered_lf_only) {
+    // Only '\n' line endings, as in the bundled CSVs
+    const char *filename = "csvstream_tests_lf.csv";
+    {
+        ofstream fout(filename);
+        fout << "n,tag,content\n";
+        for (int i = 0; i < 200000; ++i) {
+            fout << i << ",tag" << i % 7 << ",plain field " << i << "\n";
+        }
+    }
+
+    csvstream csvin(filename, {"n"});
+    vector<size_t> sizes;
+    csvin.read_all_unordered(4, [&sizes](csvstream::rows_type &batch) {
+        static std::mutex m;
+        std::lock_guard<std::mutex> lock(m);
+        sizes.push_back(batch.size());
+    });
+    size_t total = 0;
+    size_t non_empty = 0;
+    for (size_t size : sizes) {
+        total += size;
+        if (size > 0) ++non_empty;
+    }
+    ASSERT_EQUAL(total, 200000);
+    ASSERT_EQUAL(non_empty, 4);
+    remove(filename);
+}
+
+TEST(test_read_all_blank_lines) {
+    // read_csv_line() consumes a '\n' after a line ending, so each "\n\n"
+    // is one line ending, wherever the chunks are split
+    const char *filename = "csvstream_tests_blank.csv";
+    {
+        ofstream fout(filename);
+        fout << "n,tag\n";
+        for (int i = 0; i < 200000; ++i) {
+            fout << i << ",x\n\n";
+        }
+    }
+
+    vector<vector<string>> expected;
+    {
+        csvstream csvin(filename);
+        vector<string> row;
+        while (csvin >> row) {
+            expected.push_back(row);
+        }
+    }
+    ASSERT_EQUAL(expected.size(), 200000);
+
+    csvstream csvin(filename);
+    csvstream::rows_type rows = csvin.read_all(4);
+    ASSERT_TRUE(rows == expected);
+
+    csvstream csvin2(filename, ',', false);
+    ASSERT_TRUE(csvin2.read_all(4) == expected);
+    remove(filename);
+}
+
+TEST(test_read_all_bad_row) {
+    istringstream fin("a,b\n1,2\n3\n");
+    csvstream csvin(fin);
+    bool thrown = false;
+    try {
+        csvin.read_all(2);
+    }
+    catch (const csvstream_exception &e) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown);
+}
+
+TEST_MAIN()
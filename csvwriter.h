@@ -0,0 +1,255 @@
+/* -*- mode: c++ -*- */
+#ifndef CSVWRITER_H
+#define CSVWRITER_H
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include "csvstream.h"
+
+
+// csvwriter interface
+class csvwriter {
+public:
+  // Constructor from filename. Throws csvstream_exception if open fails.
+  csvwriter(const std::string &filename, char delimiter=',',
+            size_t buffer_size=1 << 16);
+
+  // Constructor from stream
+  csvwriter(std::ostream &os, char delimiter=',', size_t buffer_size=1 << 16);
+
+  // Destructor.  Writes out anything still buffered.
+  ~csvwriter();
+
+  // Return false if an error flag on underlying stream is set
+  explicit operator bool() const;
+
+  // Append one field to the current row.  A field is quoted only if it
+  // contains the delimiter, a double quote, a backslash or a line ending.
+  // Double quotes inside it are doubled, as in RFC 4180, and backslashes
+  // are doubled too, since csvstream reads a backslash as an escape.
+  // csvstream reads every field back unchanged.
+  csvwriter & field(const char *data, size_t size);
+  csvwriter & field(const std::string &value);
+  csvwriter & field(const csvfield &value);
+
+  // Append one number to the current row.  Numbers are never quoted.
+  template <typename Integer>
+  typename std::enable_if<std::is_integral<Integer>::value, csvwriter &>::type
+  field(Integer value) {
+    if (value < 0) {
+      return integer(true, 0ULL - static_cast<unsigned long long>(value));
+    }
+    return integer(false, static_cast<unsigned long long>(value));
+  }
+  csvwriter & field(double value);
+
+  // Finish the current row
+  csvwriter & end_row();
+
+  // Write a whole row
+  csvwriter & operator<< (const std::vector<std::string> &row);
+
+  // Set the number of significant digits used for doubles (default 6)
+  void precision(int digits);
+
+  // Write out everything buffered so far
+  void flush();
+
+private:
+  // File stream, used when library is called with filename ctor
+  std::ofstream fout;
+
+  // Stream in CSV format
+  std::ostream &os;
+
+  // Delimiter between columns
+  char delimiter;
+
+  // Significant digits for doubles
+  int digits;
+
+  // Whether the next field is the first in its row
+  bool row_start;
+
+  // Output collected until it reaches capacity
+  std::string buffer;
+  size_t capacity;
+
+  // Append an integer given its sign and magnitude
+  csvwriter & integer(bool negative, unsigned long long magnitude);
+
+  // Start a new field, writing a delimiter if needed
+  void begin_field();
+
+  // Append raw characters, writing out the buffer when it is full
+  void append(const char *data, size_t size);
+
+  // Disable copying because copying streams is bad!
+  csvwriter(const csvwriter &);
+  csvwriter & operator= (const csvwriter &);
+};
+
+
+csvwriter::csvwriter(const std::string &filename, char delimiter,
+                     size_t buffer_size)
+  : os(fout),
+    delimiter(delimiter),
+    digits(6),
+    row_start(true),
+    capacity(buffer_size) {
+
+  // Open file
+  fout.open(filename.c_str(), std::ios::binary);
+  if (!fout.is_open()) {
+    throw csvstream_exception("Error opening file: " + filename);
+  }
+  buffer.reserve(capacity);
+}
+
+
+csvwriter::csvwriter(std::ostream &os, char delimiter, size_t buffer_size)
+  : os(os),
+    delimiter(delimiter),
+    digits(6),
+    row_start(true),
+    capacity(buffer_size) {
+  buffer.reserve(capacity);
+}
+
+
+csvwriter::~csvwriter() {
+  flush();
+  if (fout.is_open()) fout.close();
+}
+
+
+csvwriter::operator bool() const {
+  return static_cast<bool>(os);
+}
+
+
+csvwriter & csvwriter::field(const char *data, size_t size) {
+  begin_field();
+
+  // Most fields need no quoting, so check for that first
+  bool quote = false;
+  for (size_t i=0; i<size && !quote; ++i) {
+    char c = data[i];
+    quote = c == delimiter || c == '"' || c == '\\' || c == '\n' || c == '\r';
+  }
+  if (!quote) {
+    append(data, size);
+    return *this;
+  }
+
+  append("\"", 1);
+  const char *first = data;
+  const char *last = data + size;
+  for (const char *p = first; p != last; ++p) {
+    if (*p == '"' || *p == '\\') {
+      // Write up to and including the quote or backslash, then write it
+      // again: a doubled quote as in RFC 4180, and an escaped backslash
+      append(first, static_cast<size_t>(p - first) + 1);
+      append(p, 1);
+      first = p + 1;
+    }
+  }
+  append(first, static_cast<size_t>(last - first));
+  append("\"", 1);
+  return *this;
+}
+
+
+csvwriter & csvwriter::field(const std::string &value) {
+  return field(value.data(), value.size());
+}
+
+
+csvwriter & csvwriter::field(const csvfield &value) {
+  return field(value.data, value.size);
+}
+
+
+csvwriter & csvwriter::integer(bool negative, unsigned long long magnitude) {
+  begin_field();
+
+  // Write digits backwards from the end of a small buffer
+  char text[24];
+  char *p = text + sizeof(text);
+  do {
+    *--p = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude);
+  if (negative) *--p = '-';
+  append(p, static_cast<size_t>(text + sizeof(text) - p));
+  return *this;
+}
+
+
+csvwriter & csvwriter::field(double value) {
+  begin_field();
+  char text[32];
+  int n = std::snprintf(text, sizeof(text), "%.*g", digits, value);
+  if (n < 0) {
+    throw csvstream_exception("Error formatting number");
+  }
+  if (static_cast<size_t>(n) < sizeof(text)) {
+    append(text, static_cast<size_t>(n));
+    return *this;
+  }
+
+  // snprintf returned the length it needed, which did not fit.  This only
+  // happens with a large precision, so format again into a larger buffer.
+  std::vector<char> large(static_cast<size_t>(n) + 1);
+  std::snprintf(large.data(), large.size(), "%.*g", digits, value);
+  append(large.data(), static_cast<size_t>(n));
+  return *this;
+}
+
+
+csvwriter & csvwriter::end_row() {
+  append("\n", 1);
+  row_start = true;
+  return *this;
+}
+
+
+csvwriter & csvwriter::operator<< (const std::vector<std::string> &row) {
+  for (size_t i=0; i<row.size(); ++i) {
+    field(row[i]);
+  }
+  return end_row();
+}
+
+
+void csvwriter::precision(int digits_in) {
+  digits = digits_in;
+}
+
+
+void csvwriter::flush() {
+  os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  os.flush();
+  buffer.clear();
+}
+
+
+void csvwriter::begin_field() {
+  if (!row_start) append(&delimiter, 1);
+  row_start = false;
+}
+
+
+void csvwriter::append(const char *data, size_t size) {
+  if (buffer.size() + size > capacity) {
+    os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
+  }
+  buffer.append(data, size);
+}
+
+#endif
@@ -0,0 +1,104 @@
+//
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "csvwriter.h"
+#include "unit_test_framework.h"
+
+using namespace std;
+
+TEST(test_write_rows) {
+    ostringstream fout;
+    {
+        csvwriter csvout(fout);
+        csvout << vector<string>({"tag", "content"});
+        csvout.field("exam").field("when, where").end_row();
+        csvout.field("euchre").field("say \"pass\"\nor not").end_row();
+    }
+    ASSERT_EQUAL(fout.str(), "tag,content\n"
+                             "exam,\"when, where\"\n"
+                             "euchre,\"say \"\"pass\"\"\nor not\"\n");
+}
+
+TEST(test_write_numbers) {
+    ostringstream fout;
+    {
+        csvwriter csvout(fout, '\t');
+        csvout.field(0).field(-42).field(size_t(18446744073709551615ULL));
+        csvout.end_row();
+        csvout.precision(3);
+        csvout.field(-13.6569).field(0.5).end_row();
+    }
+    ASSERT_EQUAL(fout.str(), "0\t-42\t18446744073709551615\n-13.7\t0.5\n");
+}
+
+TEST(test_write_long_number) {
+    ostringstream fout;
+    {
+        csvwriter csvout(fout);
+        csvout.precision(40);
+        csvout.field(1e300).field(0.5).end_row();
+    }
+    ASSERT_EQUAL(fout.str(),
+                 "1.000000000000000052504760255204420248704e+300,0.5\n");
+}
+
+TEST(test_write_small_buffer) {
+    ostringstream fout;
+    csvwriter csvout(fout, ',', 4);
+    csvout.field("abcdefgh").field("ij").end_row();
+    csvout.flush();
+    ASSERT_EQUAL(fout.str(), "abcdefgh,ij\n");
+}
+
+TEST(test_round_trip) {
+    const vector<vector<string>> rows = {
+        {"exam", "when, where\nand how"},
+        {"euchre", "say \"pass\", or not"},
+        {"path\\", "C:\\tmp\\\"x\""},
+        {"\"\"", "\\\\\r\n"},
+        {"", "last"},
+    };
+    stringstream buffer;
+    {
+        csvwriter csvout(buffer);
+        csvout << vector<string>({"tag", "content"});
+        for (const vector<string> &row : rows) {
+            csvout << row;
+        }
+    }
+    const string text = buffer.str();
+
+    // Every field reads back as it was written, from a stream
+    csvstream csvin(buffer);
+    vector<string> row;
+    for (const vector<string> &expected : rows) {
+        ASSERT_TRUE(bool(csvin >> row));
+        ASSERT_TRUE(row == expected);
+    }
+    ASSERT_FALSE(bool(csvin >> row));
+
+    // and from a mapped file read as views
+    const char *filename = "csvwriter_tests.tmp.csv";
+    {
+        ofstream fout(filename, ios::binary);
+        fout << text;
+    }
+    {
+        csvstream csvfile(filename);
+        vector<csvfield> views;
+        for (const vector<string> &expected : rows) {
+            ASSERT_TRUE(bool(csvfile >> views));
+            ASSERT_EQUAL(views[0].str(), expected[0]);
+            ASSERT_EQUAL(views[1].str(), expected[1]);
+        }
+        ASSERT_FALSE(bool(csvfile >> views));
+    }
+    remove(filename);
+}
+
+TEST_MAIN()
@@ -1,6 +1,7 @@
 
 
 #include "csvstream.h"
+#include "csvwriter.h"
 #include <cassert>
 #include <cmath>
 #include <iostream>
@@ -11,6 +12,7 @@
 #include <string>
 #include <set>
 #include <utility>
+#include <cstring>
 
 using namespace std;
 
@@ -53,23 +55,23 @@ public:
 
     void training_classifier(csvstream &train_file, bool debug) {
         numPosts = 0;      
-        map <string, string> line;
+        const size_t tag = train_file.column_index("tag");
+        const size_t content = train_file.column_index("content");
+        vector<string> line;
         if (debug) cout << "training data:" << endl;
         while (train_file >> line) {
             numPosts++;
-            label_posts[line["tag"]] += 1;
-            uniqueWords = unique_words(line["content"]);
+            label_posts[line[tag]] += 1;
+            uniqueWords = unique_words(line[content]);
             set<string>::iterator i;
             for (i = uniqueWords.begin(); i != uniqueWords.end(); ++i) {
                 word_posts[*i] += 1;
-                word_label[line["tag"]][*i] += 1;
+                word_label[line[tag]][*i] += 1;
                 numUniqueWords++;
             }
             if (debug == true) {
-                string label;
-                set<string> content;
-                cout << "  label = " << line["tag"] 
-                        << ", content = " << line["content"] << endl;
+                cout << "  label = " << line[tag] 
+                        << ", content = " << line[content] << endl;
             }
         }
     }
@@ -151,20 +153,28 @@ public:
 
 
 
-    void test(csvstream &test_file) {
+    // Writes one row per post to predictions if it is not null, instead of
+    // printing each post.
+    void test(csvstream &test_file, csvwriter *predictions) {
         int post_count = 0;
         int post_correct = 0;
         cout << "test data:" << endl;
-        map <string, string> line;
+        const size_t tag = test_file.column_index("tag");
+        const size_t content = test_file.column_index("content");
+        vector<string> line;
         pair<string, double> predictor;
         set<string> words;
+        if (predictions) {
+            *predictions << vector<string>{"correct", "predicted",
+                                           "log_probability"};
+        }
 
 
         while (test_file >> line) {
             temp_label_likelihood = label_likelihood;
             double value = 0;
             map<string, double>::iterator check;
-            words = unique_words(line["content"]);
+            words = unique_words(line[content]);
             
             for (auto const &i : label_likelihood) {
                 double log = 0;
@@ -190,13 +200,19 @@ public:
             }
             predictor = {entryWithMaxValue.first, entryWithMaxValue.second};
 
-            cout << "  correct = " << line["tag"] << ", predicted = " << 
-                    predictor.first << ", log-probability score = " 
-                        << predictor.second << endl;
-            cout << "  content = " << line["content"] << endl;
-            cout << endl;
+            if (predictions) {
+                predictions->field(line[tag]).field(predictor.first)
+                        .field(predictor.second).end_row();
+            }
+            else {
+                cout << "  correct = " << line[tag] << ", predicted = " << 
+                        predictor.first << ", log-probability score = " 
+                            << predictor.second << '\n';
+                cout << "  content = " << line[content] << '\n';
+                cout << '\n';
+            }
 
-            if (predictor.first == line["tag"]) {
+            if (predictor.first == line[tag]) {
                 post_correct++;
                 post_count++;
             }
@@ -215,19 +231,27 @@ public:
 int main(int argc, char *argv[]) {
     cout.precision(3);
     bool debug = false;
-    if (argc != 3 && argc != 4) {
-        cout << "Usage: main.exe TRAIN_FILE TEST_FILE [--debug]" << endl;
-        return -1;
-    }
-    if (argc == 4 && !(strcmp(argv[3], "--debug") == 0)) {
-        cout << "Usage: main.exe TRAIN_FILE TEST_FILE [--debug]" << endl;
+    const char *output = nullptr;
+    const char *usage =
+            "Usage: main.exe TRAIN_FILE TEST_FILE [--debug] [--output FILE]";
+    if (argc < 3) {
+        cout << usage << endl;
         return -1;
     }
-    else if (argc == 4 && (strcmp(argv[3], "--debug") == 0)) {
-        debug = true;
+    for (int i = 3; i < argc; ++i) {
+        if (strcmp(argv[i], "--debug") == 0) {
+            debug = true;
+        }
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        }
+        else {
+            cout << usage << endl;
+            return -1;
+        }
     }
-    csvstream train_file(argv[1]);
-    csvstream test_file(argv[2]);
+    csvstream train_file(argv[1], {"tag", "content"});
+    csvstream test_file(argv[2], {"tag", "content"});
     if (!train_file) {
         cout << "Error opening file: " << argv[1] << endl;
         return 1;
@@ -236,7 +260,15 @@ int main(int argc, char *argv[]) {
         cout << "Error opening file: " << argv[2] << endl;
         return 1;
     }
+    train_file.start_readahead();
+    test_file.start_readahead();
     Classifier c;
     c.train(train_file, debug);
-    c.test(test_file);
-}
\ No newline at end of file
+    if (output) {
+        csvwriter predictions(output);
+        c.test(test_file, &predictions);
+    }
+    else {
+        c.test(test_file, nullptr);
+    }
+}